@@ -12,15 +12,21 @@ from esphome.const import (
     CONF_MODEL,
     CONF_TAG,
     CONF_TIMEOUT,
+    CONF_UPDATE_INTERVAL,
     CONF_UUID,
     DEVICE_CLASS_BATTERY,
     DEVICE_CLASS_CONNECTIVITY,
+    DEVICE_CLASS_DURATION,
     DEVICE_CLASS_EMPTY,
     DEVICE_CLASS_RUNNING,
     DEVICE_CLASS_VOLTAGE,
+    ENTITY_CATEGORY_DIAGNOSTIC,
+    SCHEDULER_DONT_RUN,
     STATE_CLASS_MEASUREMENT,
     STATE_CLASS_NONE,
+    STATE_CLASS_TOTAL_INCREASING,
     UNIT_EMPTY,
+    UNIT_MILLISECOND,
     UNIT_PERCENT,
     UNIT_VOLT,
 )
@@ -53,6 +59,24 @@ SesameLock = sesame_lock_ns.class_("SesameLock", lock.Lock)
 BotFeature = sesame_lock_ns.class_("BotFeature")
 BinarySensorWithInvalidate = sesame_lock_ns.class_("BinarySensorWithInvalidate", binary_sensor.BinarySensor)
 
+State_t = sesame_lock_ns.enum("state_t", True)
+CONNECTION_PHASES = {
+    "wait_connect": State_t.wait_connect,
+    "wait_server_disconnect": State_t.wait_server_disconnect,
+    "wait_radio": State_t.wait_radio,
+    "connecting": State_t.connecting,
+    "authenticating": State_t.authenticating,
+}
+LatencyStat_t = sesame_lock_ns.enum("latency_stat_t", True)
+LATENCY_STATS = {
+    "last": LatencyStat_t.last,
+    "min": LatencyStat_t.min,
+    "avg": LatencyStat_t.avg,
+    "p50": LatencyStat_t.p50,
+    "p95": LatencyStat_t.p95,
+    "max": LatencyStat_t.max,
+}
+
 sesame_server_ns = cg.esphome_ns.namespace("sesame_server")
 SesameServerComponent = sesame_server_ns.class_("SesameServerComponent")
 
@@ -69,6 +93,7 @@ CONF_HISTORY_BATTERY_PCT_S = "battery_pct"
 CONF_HISTORY_SCALED_VOLTAGE2_S = "scaled_voltage2"
 CONF_HISTORY_BATTERY_PCT2_S = "battery_pct2"
 CONF_HISTORY_EXTRA_S = "extra"
+CONF_HISTORY_EVENT_S = "event"
 CONF_TRIGGER_TYPE_S = "trigger_type"
 CONF_CONNECT_RETRY_LIMIT = "connect_retry_limit"
 CONF_UNKNOWN_STATE_ALTERNATIVE = "unknown_state_alternative"
@@ -80,6 +105,32 @@ CONF_RUNNING_SENSOR = "running_sensor"
 CONF_ALWAYS_CONNECT = "always_connect"
 CONF_FAST_NOTIFY = "fast_notify"
 CONF_SERVER_ID = "server_id"
+CONF_CONNECT_SLOTS = "connect_slots"
+CONF_PASSIVE = "passive"
+CONF_ADVERTISEMENT_TIMEOUT = "advertisement_timeout"
+CONF_PUBLISH_FILTER = "publish_filter"
+CONF_BATTERY_PCT_THRESHOLD = "battery_pct_threshold"
+CONF_BATTERY_VOLTAGE_THRESHOLD = "battery_voltage_threshold"
+CONF_MAX_INTERVAL = "max_interval"
+CONF_SUPPRESSED_PUBLISHES = "suppressed_publishes"
+CONF_ADAPTIVE_POLLING = "adaptive_polling"
+CONF_ACTIVE_INTERVAL = "active_interval"
+CONF_ACTIVE_WINDOW = "active_window"
+CONF_EFFECTIVE_UPDATE_INTERVAL = "effective_update_interval"
+CONF_MEMORY_BUDGET = "memory_budget"
+CONF_STALL_TIMEOUT = "stall_timeout"
+CONF_STALL_POSITION = "stall_position"
+CONF_POSITION_SENSOR = "position"
+CONF_TARGET_SENSOR = "target"
+CONF_MOTION_PUBLISH_INTERVAL = "motion_publish_interval"
+CONF_CONNECT_WAIT_TIME = "connect_wait_time"
+CONF_CONNECT_RETRY_MIN_INTERVAL = "connect_retry_min_interval"
+CONF_CONNECT_RETRY_MAX_INTERVAL = "connect_retry_max_interval"
+CONF_CONNECT_BACKOFF_LEVEL = "connect_backoff_level"
+CONF_COMMAND_QUEUE_TIMEOUT = "command_queue_timeout"
+CONF_PHASE_LATENCY = "phase_latency"
+CONF_COMMAND_LATENCY = "command_latency"
+CONF_COMMAND_ACK_LATENCY = "command_ack_latency"
 
 SesameModel_t = cg.global_ns.enum("libsesame3bt::Sesame::model_t", True)
 SESAME_MODELS = {
@@ -204,12 +255,39 @@ def validate_lockable(config: ConfigType) -> ConfigType:
 
 
 def validate_always_connect(config: ConfigType) -> ConfigType:
+    if config[CONF_PASSIVE]:
+        if CONF_BOT in config:
+            raise cv.Invalid("`passive` cannot be used with `bot`")
+        # Without polling, nothing would connect to receive the first status
+        if config[CONF_UPDATE_INTERVAL].total_milliseconds == SCHEDULER_DONT_RUN:
+            raise cv.Invalid("`passive` requires `update_interval`")
+        config[CONF_ALWAYS_CONNECT] = False
+        return config
     if CONF_ALWAYS_CONNECT and not config[CONF_ALWAYS_CONNECT]:
         if CONF_LOCK in config or CONF_BOT in config:
             raise cv.Invalid("When using `lock` or `bot`, `always_connect` must be True")
     return config
 
 
+def validate_adaptive_polling(config: ConfigType) -> ConfigType:
+    if CONF_ADAPTIVE_POLLING not in config:
+        if CONF_EFFECTIVE_UPDATE_INTERVAL in config:
+            raise cv.Invalid(f"'{CONF_EFFECTIVE_UPDATE_INTERVAL}' requires '{CONF_ADAPTIVE_POLLING}'")
+        return config
+    interval = config[CONF_UPDATE_INTERVAL]
+    if interval.total_milliseconds == SCHEDULER_DONT_RUN:
+        raise cv.Invalid(f"'{CONF_ADAPTIVE_POLLING}' requires '{CONF_UPDATE_INTERVAL}'")
+    if config[CONF_ADAPTIVE_POLLING][CONF_ACTIVE_INTERVAL] >= interval:
+        raise cv.Invalid(f"'{CONF_ACTIVE_INTERVAL}' must be less than '{CONF_UPDATE_INTERVAL}'")
+    return config
+
+
+def validate_connect_retry_interval(config: ConfigType) -> ConfigType:
+    if config[CONF_CONNECT_RETRY_MAX_INTERVAL] < config[CONF_CONNECT_RETRY_MIN_INTERVAL]:
+        raise cv.Invalid(f"'{CONF_CONNECT_RETRY_MAX_INTERVAL}' must not be less than '{CONF_CONNECT_RETRY_MIN_INTERVAL}'")
+    return config
+
+
 def validate_bot_features(config: ConfigType) -> ConfigType:
     if CONF_LOCK in config and CONF_BOT in config:
         raise cv.Invalid("Cannot define both `lock` and `bot` on one Bot device")
@@ -303,15 +381,40 @@ def lock_history_schema(prefix) -> dict:
             accuracy_decimals=1,
         ),
         cv.Optional(prefix + CONF_HISTORY_EXTRA_S): text_sensor.text_sensor_schema(),
+        cv.Optional(prefix + CONF_HISTORY_EVENT_S): text_sensor.text_sensor_schema(),
     }
 
 
+def latency_sensors_schema(stats) -> cv.Schema:
+    return cv.Schema(
+        {
+            cv.Optional(stat): sensor.sensor_schema(
+                unit_of_measurement=UNIT_MILLISECOND,
+                device_class=DEVICE_CLASS_DURATION,
+                state_class=STATE_CLASS_MEASUREMENT,
+                accuracy_decimals=0,
+                entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+            )
+            for stat in stats
+        }
+    )
+
+
 lock_schema = {
     cv.GenerateID(): cv.declare_id(SesameLock),
     cv.Optional(CONF_TAG, default="ESPHome"): cv.string,
     cv.Optional(CONF_UNKNOWN_STATE_ALTERNATIVE): cv.enum(LOCK_STATES),
     cv.Optional(CONF_UNKNOWN_STATE_TIMEOUT, default="20s"): cv.positive_time_period_milliseconds,
     cv.Optional(CONF_FAST_NOTIFY, default=False): cv.boolean,
+    cv.Optional(CONF_COMMAND_QUEUE_TIMEOUT, default="30s"): cv.positive_time_period_milliseconds,
+    cv.Optional(CONF_COMMAND_LATENCY): latency_sensors_schema(["last", "p50", "p95"]),
+    cv.Optional(CONF_COMMAND_ACK_LATENCY): latency_sensors_schema(["last", "p50", "p95"]),
+    cv.Optional(CONF_STALL_TIMEOUT): cv.positive_time_period_milliseconds,
+    cv.Optional(CONF_STALL_POSITION): sensor.sensor_schema(
+        unit_of_measurement=UNIT_EMPTY,
+        state_class=STATE_CLASS_MEASUREMENT,
+        accuracy_decimals=0,
+    ),
 }
 
 
@@ -358,6 +461,65 @@ CONFIG_SCHEMA = cv.All(
             ),
             cv.Optional(CONF_TIMEOUT, default="10s"): cv.positive_time_period_milliseconds,
             cv.Optional(CONF_ALWAYS_CONNECT, default=True): cv.boolean,
+            cv.Optional(CONF_CONNECT_SLOTS): cv.int_range(min=1, max=9),
+            cv.Optional(CONF_PASSIVE, default=False): cv.boolean,
+            cv.Optional(CONF_PUBLISH_FILTER): cv.Schema(
+                {
+                    cv.Optional(CONF_BATTERY_PCT_THRESHOLD, default=0): cv.positive_float,
+                    cv.Optional(CONF_BATTERY_VOLTAGE_THRESHOLD, default=0): cv.positive_float,
+                    cv.Optional(CONF_MAX_INTERVAL, default="1h"): cv.positive_time_period_milliseconds,
+                }
+            ),
+            cv.Optional(CONF_SUPPRESSED_PUBLISHES): sensor.sensor_schema(
+                unit_of_measurement=UNIT_EMPTY,
+                state_class=STATE_CLASS_TOTAL_INCREASING,
+                accuracy_decimals=0,
+                entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+            ),
+            cv.Optional(CONF_ADAPTIVE_POLLING): cv.Schema(
+                {
+                    cv.Optional(CONF_ACTIVE_INTERVAL, default="10s"): cv.positive_time_period_milliseconds,
+                    cv.Optional(CONF_ACTIVE_WINDOW, default="2min"): cv.positive_time_period_milliseconds,
+                }
+            ),
+            cv.Optional(CONF_EFFECTIVE_UPDATE_INTERVAL): sensor.sensor_schema(
+                unit_of_measurement=UNIT_MILLISECOND,
+                device_class=DEVICE_CLASS_DURATION,
+                state_class=STATE_CLASS_MEASUREMENT,
+                accuracy_decimals=0,
+                entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+            ),
+            cv.Optional(CONF_MEMORY_BUDGET): cv.positive_not_null_int,
+            cv.Optional(CONF_POSITION_SENSOR): sensor.sensor_schema(
+                unit_of_measurement=UNIT_EMPTY,
+                state_class=STATE_CLASS_MEASUREMENT,
+                accuracy_decimals=0,
+            ),
+            cv.Optional(CONF_TARGET_SENSOR): sensor.sensor_schema(
+                unit_of_measurement=UNIT_EMPTY,
+                state_class=STATE_CLASS_MEASUREMENT,
+                accuracy_decimals=0,
+            ),
+            cv.Optional(CONF_MOTION_PUBLISH_INTERVAL, default="500ms"): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_ADVERTISEMENT_TIMEOUT, default="60s"): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_CONNECT_WAIT_TIME): sensor.sensor_schema(
+                unit_of_measurement=UNIT_MILLISECOND,
+                device_class=DEVICE_CLASS_DURATION,
+                state_class=STATE_CLASS_MEASUREMENT,
+                accuracy_decimals=0,
+                entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+            ),
+            cv.Optional(CONF_PHASE_LATENCY): cv.Schema(
+                {cv.Optional(phase): latency_sensors_schema(["min", "avg", "p95", "max"]) for phase in CONNECTION_PHASES}
+            ),
+            cv.Optional(CONF_CONNECT_RETRY_MIN_INTERVAL, default="3s"): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_CONNECT_RETRY_MAX_INTERVAL, default="60s"): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_CONNECT_BACKOFF_LEVEL): sensor.sensor_schema(
+                unit_of_measurement=UNIT_EMPTY,
+                state_class=STATE_CLASS_MEASUREMENT,
+                accuracy_decimals=0,
+                entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+            ),
         }
     ).extend(cv.polling_component_schema("never")),
     validate_address,
@@ -365,10 +527,22 @@ CONFIG_SCHEMA = cv.All(
     validate_lockable,
     validate_always_connect,
     validate_bot_features,
+    validate_connect_retry_interval,
+    validate_adaptive_polling,
 )
 
 
+def publish_filter_args(config):
+    return (
+        config[CONF_BATTERY_PCT_THRESHOLD],
+        config[CONF_BATTERY_VOLTAGE_THRESHOLD],
+        config[CONF_MAX_INTERVAL].total_milliseconds,
+    )
+
+
 async def add_history_codes(lock_obj, config, prefix):
+    if any(key.startswith(prefix) for key in config):
+        cg.add_define("USE_SESAME_LOCK_HISTORY")
     if prefix + CONF_HISTORY_TAG_S in config:
         s = await text_sensor.new_text_sensor(config[prefix + CONF_HISTORY_TAG_S])
         cg.add(getattr(lock_obj, "set_" + prefix + CONF_HISTORY_TAG_S + "_sensor")(s))
@@ -393,6 +567,9 @@ async def add_history_codes(lock_obj, config, prefix):
     if prefix + CONF_HISTORY_EXTRA_S in config:
         s = await text_sensor.new_text_sensor(config[prefix + CONF_HISTORY_EXTRA_S])
         cg.add(getattr(lock_obj, "set_" + prefix + CONF_HISTORY_EXTRA_S + "_sensor")(s))
+    if prefix + CONF_HISTORY_EVENT_S in config:
+        s = await text_sensor.new_text_sensor(config[prefix + CONF_HISTORY_EVENT_S])
+        cg.add(getattr(lock_obj, "set_" + prefix + CONF_HISTORY_EVENT_S + "_sensor")(s))
 
 
 async def to_code(config):
@@ -410,12 +587,58 @@ async def to_code(config):
     if CONF_BATTERY_CRITICAL in config:
         s = await binary_sensor.new_binary_sensor(config[CONF_BATTERY_CRITICAL])
         cg.add(var.set_battery_critical_sensor(s))
+    if CONF_CONNECT_WAIT_TIME in config:
+        s = await sensor.new_sensor(config[CONF_CONNECT_WAIT_TIME])
+        cg.add(var.set_connect_wait_sensor(s))
+    if CONF_CONNECT_BACKOFF_LEVEL in config:
+        s = await sensor.new_sensor(config[CONF_CONNECT_BACKOFF_LEVEL])
+        cg.add(var.set_connect_backoff_sensor(s))
+    if CONF_PUBLISH_FILTER in config:
+        cg.add(var.set_publish_filter(*publish_filter_args(config[CONF_PUBLISH_FILTER])))
+    if CONF_SUPPRESSED_PUBLISHES in config:
+        s = await sensor.new_sensor(config[CONF_SUPPRESSED_PUBLISHES])
+        cg.add(var.set_suppressed_publishes_sensor(s))
+    if CONF_POSITION_SENSOR in config:
+        s = await sensor.new_sensor(config[CONF_POSITION_SENSOR])
+        cg.add(var.set_position_sensor(s))
+    if CONF_TARGET_SENSOR in config:
+        s = await sensor.new_sensor(config[CONF_TARGET_SENSOR])
+        cg.add(var.set_target_sensor(s))
+    cg.add(var.set_motion_publish_interval(config[CONF_MOTION_PUBLISH_INTERVAL].total_milliseconds))
+    if CONF_MEMORY_BUDGET in config:
+        cg.add(var.set_memory_budget(config[CONF_MEMORY_BUDGET]))
+    if CONF_ADAPTIVE_POLLING in config:
+        aconfig = config[CONF_ADAPTIVE_POLLING]
+        cg.add(
+            var.set_adaptive_polling(
+                aconfig[CONF_ACTIVE_INTERVAL].total_milliseconds,
+                aconfig[CONF_ACTIVE_WINDOW].total_milliseconds,
+            )
+        )
+    if CONF_EFFECTIVE_UPDATE_INTERVAL in config:
+        s = await sensor.new_sensor(config[CONF_EFFECTIVE_UPDATE_INTERVAL])
+        cg.add(var.set_update_interval_sensor(s))
+    for phase, pconfig in config.get(CONF_PHASE_LATENCY, {}).items():
+        for stat, sconfig in pconfig.items():
+            s = await sensor.new_sensor(sconfig)
+            cg.add(var.set_phase_latency_sensor(CONNECTION_PHASES[phase], LATENCY_STATS[stat], s))
     if CONF_CONNECT_RETRY_LIMIT in config:
         cg.add(var.set_connect_retry_limit(config[CONF_CONNECT_RETRY_LIMIT]))
+    cg.add(
+        var.set_connect_retry_interval(
+            config[CONF_CONNECT_RETRY_MIN_INTERVAL].total_milliseconds,
+            config[CONF_CONNECT_RETRY_MAX_INTERVAL].total_milliseconds,
+        )
+    )
     if CONF_TIMEOUT in config:
         cg.add(var.set_connection_timeout(config[CONF_TIMEOUT].total_milliseconds))
     if CONF_ALWAYS_CONNECT in config:
         cg.add(var.set_always_connect(config[CONF_ALWAYS_CONNECT]))
+    if config[CONF_PASSIVE]:
+        cg.add(var.set_passive(True))
+        cg.add(var.set_advertisement_timeout(config[CONF_ADVERTISEMENT_TIMEOUT].total_milliseconds))
+    if CONF_CONNECT_SLOTS in config:
+        cg.add(var.set_connect_slots(config[CONF_CONNECT_SLOTS]))
     if CONF_SERVER_ID in config:
         server = await cg.get_variable(config[CONF_SERVER_ID])
         cg.add(var.set_sesame_server(server))
@@ -426,12 +649,27 @@ async def to_code(config):
         await lock.register_lock(lck, config[CONF_LOCK])
         for prefix in CONF_HISTORY_PREFIXES:
             await add_history_codes(lck, lconfig, prefix)
+        if CONF_PUBLISH_FILTER in config:
+            cg.add(lck.set_publish_filter(*publish_filter_args(config[CONF_PUBLISH_FILTER])))
         if CONF_UNKNOWN_STATE_ALTERNATIVE in lconfig:
             cg.add(lck.set_unknown_state_alternative(lconfig[CONF_UNKNOWN_STATE_ALTERNATIVE]))
         if CONF_UNKNOWN_STATE_TIMEOUT in lconfig:
             cg.add(lck.set_unknown_state_timeout(lconfig[CONF_UNKNOWN_STATE_TIMEOUT].total_milliseconds))
         if CONF_FAST_NOTIFY in lconfig:
             cg.add(lck.set_fast_notify(lconfig[CONF_FAST_NOTIFY]))
+        if CONF_COMMAND_QUEUE_TIMEOUT in lconfig:
+            cg.add(lck.set_command_queue_timeout(lconfig[CONF_COMMAND_QUEUE_TIMEOUT].total_milliseconds))
+        for stat, sconfig in lconfig.get(CONF_COMMAND_LATENCY, {}).items():
+            s = await sensor.new_sensor(sconfig)
+            cg.add(lck.set_command_latency_sensor(LATENCY_STATS[stat], s))
+        for stat, sconfig in lconfig.get(CONF_COMMAND_ACK_LATENCY, {}).items():
+            s = await sensor.new_sensor(sconfig)
+            cg.add(lck.set_command_ack_latency_sensor(LATENCY_STATS[stat], s))
+        if CONF_STALL_TIMEOUT in lconfig:
+            cg.add(lck.set_stall_timeout(lconfig[CONF_STALL_TIMEOUT].total_milliseconds))
+        if CONF_STALL_POSITION in lconfig:
+            s = await sensor.new_sensor(lconfig[CONF_STALL_POSITION])
+            cg.add(lck.set_stall_position_sensor(s))
         cg.add(var.set_feature(lck))
         cg.add(lck.init())
     if CONF_BOT in config:
@@ -0,0 +1,92 @@
+#include "adv_scanner.h"
+#include <esphome/core/log.h>
+#include <libsesame3bt/ScannerCore.h>
+#include <algorithm>
+#include "sesame_component.h"
+
+using libsesame3bt::Sesame;
+
+namespace {
+
+constexpr const char* TAG = "sesame_lock";
+constexpr uint32_t SCAN_CHECK_INTERVAL = 1'000;
+constexpr uint16_t SCAN_INTERVAL_MS = 1'000;
+constexpr uint16_t SCAN_WINDOW_MS = 100;
+
+}  // namespace
+
+namespace esphome::sesame_lock {
+
+void
+AdvertisementScanner::add_listener(SesameComponent* listener) {
+	listeners.push_back(listener);
+}
+
+void
+AdvertisementScanner::loop(uint32_t now) {
+	if (listeners.empty() || now - last_checked < SCAN_CHECK_INTERVAL) {
+		return;
+	}
+	last_checked = now;
+	auto* scan = NimBLEDevice::getScan();
+	if (scan->isScanning()) {
+		return;
+	}
+	// Do not compete with a connection being established
+	if (std::any_of(std::cbegin(listeners), std::cend(listeners), [](auto* c) {
+		    return c->my_state == state_t::connecting || c->my_state == state_t::wait_radio;
+	    })) {
+		return;
+	}
+	start();
+}
+
+bool
+AdvertisementScanner::start() {
+	auto* scan = NimBLEDevice::getScan();
+	if (!initialized) {
+		scan->setScanCallbacks(this, true);
+		scan->setActiveScan(false);
+		scan->setDuplicateFilter(false);
+		scan->setInterval(SCAN_INTERVAL_MS);
+		scan->setWindow(SCAN_WINDOW_MS);
+		scan->setMaxResults(0);
+		initialized = true;
+	}
+	if (!scan->start(0, false, true)) {
+		ESP_LOGW(TAG, "Failed to start scan");
+		return false;
+	}
+	ESP_LOGV(TAG, "Scan started");
+	return true;
+}
+
+/**
+ * Runs in the NimBLE host task.
+ */
+void
+AdvertisementScanner::onResult(const NimBLEAdvertisedDevice* device) {
+	static const NimBLEUUID SESAME_SRV_UUID{Sesame::SESAME3_SRV_UUID};
+	if (!device->isAdvertisingService(SESAME_SRV_UUID)) {
+		return;
+	}
+	auto manu_data = device->getManufacturerData();
+	uint8_t uuid_bin[16];
+	auto [model, flag_byte, is_valid] = libsesame3bt::core::parse_advertisement(manu_data, device->getName(), uuid_bin);
+	if (!is_valid) {
+		return;
+	}
+	uint64_t address = device->getAddress();
+	for (auto* c : listeners) {
+		if (c->is_advertisement_of(address, uuid_bin)) {
+			c->handle_advertisement(static_cast<uint8_t>(flag_byte));
+		}
+	}
+}
+
+void
+AdvertisementScanner::onScanEnd(const NimBLEScanResults& results, int reason) {
+	ESP_LOGV(TAG, "Scan ended, reason=%d", reason);
+}
+
+}  // namespace esphome::sesame_lock
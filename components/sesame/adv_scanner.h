@@ -0,0 +1,35 @@
+#pragma once
+
+#include <NimBLEDevice.h>
+#include <cstdint>
+#include <vector>
+
+namespace esphome::sesame_lock {
+
+class SesameComponent;
+
+/**
+ * Shared passive BLE scanner routing SESAME advertisements to the SesameComponents that asked for them.
+ * Scanning is suspended by NimBLE while a connection is being established and restarted from loop().
+ */
+class AdvertisementScanner : public NimBLEScanCallbacks {
+ public:
+	static AdvertisementScanner& get() {
+		static AdvertisementScanner instance;
+		return instance;
+	}
+	void add_listener(SesameComponent* listener);
+	void loop(uint32_t now);
+	void onResult(const NimBLEAdvertisedDevice* device) override;
+	void onScanEnd(const NimBLEScanResults& results, int reason) override;
+
+ private:
+	std::vector<SesameComponent*> listeners;
+	uint32_t last_checked = 0;
+	bool initialized = false;
+
+	AdvertisementScanner() = default;
+	bool start();
+};
+
+}  // namespace esphome::sesame_lock
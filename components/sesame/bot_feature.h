@@ -8,13 +8,14 @@
 
 namespace esphome::sesame_lock {
 
-class BotFeature : public Feature {
+class BotFeature final : public Feature {
  public:
 	BotFeature(SesameComponent* parent, libsesame3bt::Sesame::model_t) : parent_(parent), TAG(parent->TAG) {};
 	void init() override {}
 	void loop() override {}
 	void reflect_status_changed() override;
 	void publish_initial_state() override {};
+	size_t object_size() const override { return sizeof(*this); }
 	void run(std::optional<uint8_t> script_no = std::nullopt);
 	void set_running_sensor(binary_sensor::BinarySensor* sensor) { running_sensor = sensor; }
 
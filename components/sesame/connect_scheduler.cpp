@@ -0,0 +1,164 @@
+#include "connect_scheduler.h"
+#include <NimBLEDevice.h>
+#include <esphome/core/log.h>
+#include <algorithm>
+
+namespace {
+
+constexpr const char* TAG = "sesame_lock";
+#ifdef CONFIG_BT_NIMBLE_MAX_CONNECTIONS
+constexpr uint8_t MAX_CONNECTIONS = std::min<uint8_t>(CONFIG_BT_NIMBLE_MAX_CONNECTIONS, esphome::sesame_lock::ConnectScheduler::MAX_SLOTS);
+#else
+constexpr uint8_t MAX_CONNECTIONS = esphome::sesame_lock::ConnectScheduler::MAX_SLOTS;
+#endif
+
+}  // namespace
+
+namespace esphome::sesame_lock {
+
+void
+ConnectScheduler::init(size_t capacity) {
+	std::lock_guard lock(mux);
+	for (auto& ring : rings) {
+		ring.entries = std::make_unique<entry_t[]>(capacity);
+		ring.head = ring.size = 0;
+	}
+	this->capacity = capacity;
+}
+
+void
+ConnectScheduler::set_slots(uint8_t slots) {
+	std::lock_guard lock(mux);
+	this->slots = std::clamp(std::max(this->slots, slots), uint8_t{1}, MAX_CONNECTIONS);
+}
+
+bool
+ConnectScheduler::enqueue(SesameComponent* client, connect_priority_t priority, uint32_t now) {
+	std::lock_guard lock(mux);
+	if (is_active(client)) {
+		return true;
+	}
+	auto pri = static_cast<size_t>(priority);
+	entry_t entry{client, now};
+	size_t index;
+	if (int cur = find_waiting(client, &index); cur >= 0) {
+		if (static_cast<size_t>(cur) >= pri) {
+			return true;
+		}
+		// Raise priority, keep the original enqueued time so that aging continues
+		entry = rings[cur].at(index, capacity);
+		remove_waiting(client);
+	}
+	auto& ring = rings[pri];
+	if (ring.size >= capacity) {
+		ESP_LOGE(TAG, "Connection queue overflow");
+		return false;
+	}
+	push(ring, entry);
+	return true;
+}
+
+bool
+ConnectScheduler::try_admit(SesameComponent* client, uint32_t now) {
+	std::lock_guard lock(mux);
+	if (is_active(client)) {
+		return true;
+	}
+	if (active_count >= slots) {
+		return false;
+	}
+	int pri = next_ring(now);
+	if (pri < 0) {
+		return false;
+	}
+	auto& ring = rings[pri];
+	if (ring.at(0, capacity).client != client) {
+		return false;
+	}
+	ring.head = (ring.head + 1) % capacity;
+	--ring.size;
+	active[active_count++] = client;
+	return true;
+}
+
+void
+ConnectScheduler::release(SesameComponent* client) {
+	std::lock_guard lock(mux);
+	for (uint8_t i = 0; i < active_count; i++) {
+		if (active[i] == client) {
+			active[i] = active[--active_count];
+			active[active_count] = nullptr;
+			return;
+		}
+	}
+	if (remove_waiting(client)) {
+		ESP_LOGD(TAG, "Connection queue mishandled");
+	}
+}
+
+bool
+ConnectScheduler::is_active(const SesameComponent* client) const {
+	return std::find(std::cbegin(active), std::cbegin(active) + active_count, client) != std::cbegin(active) + active_count;
+}
+
+int
+ConnectScheduler::find_waiting(const SesameComponent* client, size_t* index) const {
+	for (size_t pri = 0; pri < NUM_PRIORITIES; pri++) {
+		const auto& ring = rings[pri];
+		for (size_t i = 0; i < ring.size; i++) {
+			if (ring.at(i, capacity).client == client) {
+				*index = i;
+				return pri;
+			}
+		}
+	}
+	return -1;
+}
+
+bool
+ConnectScheduler::remove_waiting(const SesameComponent* client) {
+	bool removed = false;
+	for (auto& ring : rings) {
+		size_t kept = 0;
+		for (size_t i = 0; i < ring.size; i++) {
+			auto e = ring.at(i, capacity);
+			if (e.client != client) {
+				ring.at(kept, capacity) = e;
+				++kept;
+			}
+		}
+		removed |= kept != ring.size;
+		ring.size = kept;
+	}
+	return removed;
+}
+
+void
+ConnectScheduler::push(ring_t& ring, const entry_t& entry) {
+	ring.at(ring.size, capacity) = entry;
+	++ring.size;
+}
+
+/**
+ * Select the ring whose head should be admitted next.
+ * Effective priority is the base priority raised by waiting time; on a tie the higher base priority wins.
+ */
+int
+ConnectScheduler::next_ring(uint32_t now) const {
+	int best = -1;
+	size_t best_eff = 0;
+	for (size_t pri = NUM_PRIORITIES; pri-- > 0;) {
+		const auto& ring = rings[pri];
+		if (ring.size == 0) {
+			continue;
+		}
+		size_t eff = std::min(pri + (now - ring.at(0, capacity).enqueued) / AGING_STEP, NUM_PRIORITIES - 1);
+		if (best < 0 || eff > best_eff) {
+			best = pri;
+			best_eff = eff;
+		}
+	}
+	return best;
+}
+
+}  // namespace esphome::sesame_lock
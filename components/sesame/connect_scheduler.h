@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+namespace esphome::sesame_lock {
+
+class SesameComponent;
+
+enum class connect_priority_t : uint8_t {
+	background,  // always_connect reconnection
+	status,      // status update requested by update_interval
+	command,     // user operation waiting for the connection
+};
+
+/**
+ * Admission control for BLE connection attempts.
+ *
+ * Waiting components are kept in fixed-capacity rings (one per priority) sized from the number of SESAME instances,
+ * and up to `slots` of them may be connecting at the same time. The head with the highest priority is admitted first;
+ * waiting entries gain one priority level per AGING_STEP so that background reconnection is not starved.
+ */
+class ConnectScheduler {
+ public:
+	// Upper limit of NimBLE connections; the layout must not depend on the NimBLE configuration seen by each includer
+	static constexpr uint8_t MAX_SLOTS = 9;
+	static constexpr uint32_t AGING_STEP = 5'000;
+
+	void init(size_t capacity);
+	void set_slots(uint8_t slots);
+	uint8_t get_slots() const { return slots; }
+	bool enqueue(SesameComponent* client, connect_priority_t priority, uint32_t now);
+	bool try_admit(SesameComponent* client, uint32_t now);
+	void release(SesameComponent* client);
+
+ private:
+	static constexpr size_t NUM_PRIORITIES = static_cast<size_t>(connect_priority_t::command) + 1;
+	struct entry_t {
+		SesameComponent* client;
+		uint32_t enqueued;
+	};
+	struct ring_t {
+		std::unique_ptr<entry_t[]> entries;
+		size_t head = 0;
+		size_t size = 0;
+
+		entry_t& at(size_t i, size_t capacity) { return entries[(head + i) % capacity]; }
+		const entry_t& at(size_t i, size_t capacity) const { return entries[(head + i) % capacity]; }
+	};
+
+	std::mutex mux;
+	std::array<ring_t, NUM_PRIORITIES> rings;
+	size_t capacity = 0;
+	std::array<SesameComponent*, MAX_SLOTS> active{};
+	uint8_t active_count = 0;
+	uint8_t slots = 1;
+
+	bool is_active(const SesameComponent* client) const;
+	int find_waiting(const SesameComponent* client, size_t* index) const;
+	bool remove_waiting(const SesameComponent* client);
+	void push(ring_t& ring, const entry_t& entry);
+	int next_ring(uint32_t now) const;
+};
+
+}  // namespace esphome::sesame_lock
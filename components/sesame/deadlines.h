@@ -0,0 +1,54 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome::sesame_lock {
+
+/**
+ * Set of one-shot timers identified by enum `Id` (values 0 to `Id::count` - 1) on a millisecond clock.
+ * Comparison is done on the signed difference, so it works across millis() wraparound for timeouts shorter than 24 days.
+ */
+template <typename Id>
+class Deadlines {
+	static constexpr size_t N = static_cast<size_t>(Id::count);
+	static_assert(N <= 32);
+
+ public:
+	void arm(Id id, uint32_t now, uint32_t timeout) {
+		due[index(id)] = now + timeout;
+		armed_mask |= bit(id);
+	}
+	void cancel(Id id) { armed_mask &= ~bit(id); }
+	bool armed(Id id) const { return armed_mask & bit(id); }
+	bool any_armed() const { return armed_mask != 0; }
+	bool any_armed_except(Id id) const { return (armed_mask & ~bit(id)) != 0; }
+	/** Cancel and return true if `id` has expired */
+	bool expire(Id id, uint32_t now) {
+		if (!armed(id) || !reached(due[index(id)], now)) {
+			return false;
+		}
+		cancel(id);
+		return true;
+	}
+	/** True if any armed timer has expired */
+	bool any_expired(uint32_t now) const {
+		for (size_t i = 0; i < N; i++) {
+			if ((armed_mask & (1u << i)) && reached(due[i], now)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+ private:
+	std::array<uint32_t, N> due{};
+	uint32_t armed_mask = 0;
+
+	static constexpr size_t index(Id id) { return static_cast<size_t>(id); }
+	static constexpr uint32_t bit(Id id) { return 1u << index(id); }
+	static constexpr bool reached(uint32_t due, uint32_t now) { return static_cast<int32_t>(now - due) >= 0; }
+};
+
+}  // namespace esphome::sesame_lock
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome::sesame_lock {
+
+/**
+ * Fixed-capacity single-producer / single-consumer queue, used to pass events from the NimBLE host task to the main loop
+ * without allocation. When full, new events are dropped and counted.
+ */
+template <typename T, size_t N>
+class EventRing {
+	static_assert(N > 0 && (N & (N - 1)) == 0, "capacity must be a power of 2");
+
+ public:
+	bool push(const T& event) {
+		auto tail = tail_.load(std::memory_order_relaxed);
+		if (tail - head_.load(std::memory_order_acquire) >= N) {
+			overflows_.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		events_[tail % N] = event;
+		tail_.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+	bool pop(T& event) {
+		auto head = head_.load(std::memory_order_relaxed);
+		if (head == tail_.load(std::memory_order_acquire)) {
+			return false;
+		}
+		event = events_[head % N];
+		head_.store(head + 1, std::memory_order_release);
+		return true;
+	}
+	bool empty() const { return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire); }
+	uint32_t get_overflows() const { return overflows_.load(std::memory_order_relaxed); }
+
+ private:
+	std::array<T, N> events_{};
+	std::atomic<uint32_t> head_{0};
+	std::atomic<uint32_t> tail_{0};
+	std::atomic<uint32_t> overflows_{0};
+};
+
+}  // namespace esphome::sesame_lock
@@ -1,13 +1,22 @@
 #pragma once
 
+#include <cstddef>
+
 namespace esphome::sesame_lock {
 
+/**
+ * Lock or bot part of a SesameComponent. There is one implementation per component instance, so calls stay virtual
+ * instead of templating SesameComponent on the feature type, which would duplicate the connection code for each type.
+ */
 class Feature {
  public:
 	virtual void init() = 0;
 	virtual void loop() = 0;
 	virtual void publish_initial_state() = 0;
 	virtual void reflect_status_changed() = 0;
+	virtual bool is_idle() const { return true; }
+	virtual size_t object_size() const = 0;
+	virtual size_t heap_usage() const { return 0; }
 };
 
 }  // namespace esphome::sesame_lock
@@ -0,0 +1,63 @@
+#include "latency_stats.h"
+#include <algorithm>
+
+namespace esphome::sesame_lock {
+
+void
+latency_histogram::add(uint32_t ms) {
+	auto bucket = std::upper_bound(std::cbegin(BUCKET_BOUNDS), std::cend(BUCKET_BOUNDS), ms) - std::cbegin(BUCKET_BOUNDS);
+	++buckets[bucket];
+	++count;
+	last = ms;
+	min = std::min(min, ms);
+	max = std::max(max, ms);
+	sum += ms;
+}
+
+uint32_t
+latency_histogram::percentile(uint8_t pct) const {
+	if (count == 0) {
+		return 0;
+	}
+	uint32_t rank = (static_cast<uint64_t>(count) * pct + 99) / 100;
+	uint32_t seen = 0;
+	for (size_t i = 0; i < BUCKET_BOUNDS.size(); i++) {
+		seen += buckets[i];
+		if (seen >= rank) {
+			return std::min(BUCKET_BOUNDS[i], max);
+		}
+	}
+	return max;
+}
+
+void
+latency_sensors::publish(const latency_histogram& histogram) {
+	for (size_t i = 0; i < sensors.size(); i++) {
+		auto* sensor = sensors[i];
+		if (!sensor) {
+			continue;
+		}
+		switch (static_cast<latency_stat_t>(i)) {
+			case latency_stat_t::last:
+				sensor->publish_state(histogram.last);
+				break;
+			case latency_stat_t::min:
+				sensor->publish_state(histogram.min);
+				break;
+			case latency_stat_t::avg:
+				sensor->publish_state(histogram.average());
+				break;
+			case latency_stat_t::p50:
+				sensor->publish_state(histogram.percentile(50));
+				break;
+			case latency_stat_t::p95:
+				sensor->publish_state(histogram.percentile(95));
+				break;
+			case latency_stat_t::max:
+				sensor->publish_state(histogram.max);
+				break;
+		}
+	}
+}
+
+}  // namespace esphome::sesame_lock
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <esphome/components/sensor/sensor.h>
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+namespace esphome::sesame_lock {
+
+enum class latency_stat_t : uint8_t { last, min, avg, p50, p95, max };
+
+/**
+ * Fixed-bucket latency histogram (milliseconds).
+ * Percentiles are reported as the upper bound of the bucket containing them (the observed maximum for the last bucket).
+ */
+struct latency_histogram {
+	static constexpr std::array<uint32_t, 10> BUCKET_BOUNDS{100, 250, 500, 1'000, 2'000, 4'000, 8'000, 16'000, 32'000, 64'000};
+
+	std::array<uint32_t, BUCKET_BOUNDS.size() + 1> buckets{};
+	uint32_t count = 0;
+	uint32_t last = 0;
+	uint32_t min = UINT32_MAX;
+	uint32_t max = 0;
+	uint64_t sum = 0;
+
+	void add(uint32_t ms);
+	uint32_t percentile(uint8_t pct) const;
+	float average() const { return count ? static_cast<float>(sum) / count : NAN; }
+};
+
+struct latency_sensors {
+	std::array<sensor::Sensor*, static_cast<size_t>(latency_stat_t::max) + 1> sensors{};
+
+	void set_sensor(latency_stat_t stat, sensor::Sensor* sensor) { sensors[static_cast<size_t>(stat)] = sensor; }
+	void publish(const latency_histogram& histogram);
+};
+
+}  // namespace esphome::sesame_lock
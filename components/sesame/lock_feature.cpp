@@ -1,9 +1,11 @@
 #include "lock_feature.h"
 #include <esphome/core/hal.h>
+#include <esphome/core/helpers.h>
 #include <esphome/core/log.h>
 #include <esphome/core/version.h>
-#include <libsesame3bt/util.h>
+#include <algorithm>
 #include <cmath>
+#include <cstdio>
 #include "sesame_component.h"
 
 using esphome::lock::LockState;
@@ -12,13 +14,33 @@ using history_tag_type_t = libsesame3bt::history_tag_type_t;
 using libsesame3bt::Sesame;
 using libsesame3bt::SesameClient;
 using Status = SesameClient::Status;
-namespace util = libsesame3bt::core::util;
 
 namespace {
 
 constexpr uint32_t JAMM_DETECTION_TIMEOUT = 3'000;
 constexpr uint32_t HISTORY_TIMEOUT = 4'000;
 constexpr uint32_t MOVING_TIMEOUT = 3'000;
+constexpr uint32_t COMMAND_LATENCY_TIMEOUT = 30'000;
+constexpr uint8_t MAX_HISTORY_DRAIN = 32;
+// Histories with record_id this far below the last one are treated as after a counter reset of SESAME
+constexpr int32_t RECORD_ID_WINDOW = 256;
+constexpr uint8_t RECORD_ID_SAVE_COUNT = 8;
+constexpr uint32_t RECORD_ID_SAVE_DELAY = 60'000;
+
+/**
+ * Hex encode into `out` (at least 2 * `len` chars), no terminator is written.
+ */
+template <typename T>
+size_t
+bin2hex(const T* data, size_t len, char* out) {
+	static constexpr char digits[] = "0123456789abcdef";
+	for (size_t i = 0; i < len; i++) {
+		auto b = static_cast<uint8_t>(data[i]);
+		out[i * 2] = digits[b >> 4];
+		out[i * 2 + 1] = digits[b & 0x0f];
+	}
+	return len * 2;
+}
 
 }  // namespace
 
@@ -35,97 +57,254 @@ void
 SesameLock::init() {
 	ESP_LOGD(TAG, "lock init");
 	if (using_history()) {
-		get_history_set().reserve_tag_buffer();
-		get_all_history_set().reserve_tag_buffer();
+		get_history_set().reserve_buffers();
+		get_all_history_set().reserve_buffers();
 		parent_->sesame.set_history_callback([this](auto& client, const auto& history) {
 			ESP_LOGD(TAG, "hist: r=%u,id=%ld,type=%u,str=(%u)%.*s,svol=%.2f,svol2=%.2f", static_cast<uint8_t>(history.result),
 			         history.record_id, static_cast<uint8_t>(history.type), history.tag_len, history.tag_len, history.tag,
 			         history.scaled_voltage, history.scaled_voltage2);
+			if (history.extra.size() > MAX_HISTORY_EXTRA_SIZE) {
+				ESP_LOGW(TAG, "History extra of %u bytes truncated to %u bytes", history.extra.size(), MAX_HISTORY_EXTRA_SIZE);
+			}
+#if ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_DEBUG
 			if (history.extra.size() > 0) {
-				ESP_LOGD(TAG, "hist extra: %s", util::bin2hex(history.extra.data(), history.extra.size()).c_str());
+				std::array<char, MAX_HISTORY_EXTRA_SIZE * 2 + 1> hex;
+				auto len = bin2hex(history.extra.data(), std::min(history.extra.size(), MAX_HISTORY_EXTRA_SIZE), hex.data());
+				hex[len] = '\0';
+				ESP_LOGD(TAG, "hist extra: %s%s", hex.data(), history.extra.size() > MAX_HISTORY_EXTRA_SIZE ? "..." : "");
 			} else {
 				ESP_LOGD(TAG, "hist extra: (none)");
 			}
-			if (is_bot1()) {
-				handle_bot_history(history);
-				return;
-			}
-			if (history.result == Sesame::result_code_t::success) {
-				if (auto& hset = get_history_set(); hset.using_history() && history.type != Sesame::history_type_t::drive_locked &&
-				                                    history.type != Sesame::history_type_t::drive_unlocked &&
-				                                    history.type != Sesame::history_type_t::drive_clicked) {
-					hset.save_received_values(history.type, history.history_tag_type, std::string_view{history.tag, history.tag_len},
-					                          history.scaled_voltage, history.scaled_voltage2, history.extra);
-				}
-				if (auto& hset = get_all_history_set(); hset.using_history()) {
-					hset.save_received_values(history.type, history.history_tag_type, std::string_view{history.tag, history.tag_len},
-					                          history.scaled_voltage, history.scaled_voltage2, history.extra);
-				}
-				if (history_timeout_started > 0 && history_type_matched(lock_state, history.type)) {
-					history_timeout_started = 0;
-					parent_->defer([this]() { publish_lock_history_state(); });
-				}
-				if (get_all_history_set().using_history()) {
-					parent_->defer([this]() { publish_all_history_state(); });
-				}
-			}
+#endif
+			this->history->events.push(history);
+			parent_->wake_loop();
 		});
 	}
 }
 
+/**
+ * Filter battery values of histories like the battery sensors of the component. Call after setting history sensors.
+ */
+void
+SesameLock::set_publish_filter(float pct_threshold, float voltage_threshold, uint32_t max_interval) {
+	if (!using_history()) {
+		return;
+	}
+	for (auto& hs : history->sets) {
+		hs.configure_filters(pct_threshold, voltage_threshold, max_interval, &parent_->suppressed_publishes);
+	}
+}
+
+history_record::history_record(const SesameClient::History& history)
+    : record_id(history.record_id),
+      result(history.result),
+      type(history.type),
+      history_tag_type(history.history_tag_type),
+      scaled_voltage(history.scaled_voltage),
+      scaled_voltage2(history.scaled_voltage2) {
+	tag_len = std::min<size_t>(history.tag_len, tag.size());
+	std::copy_n(history.tag, tag_len, tag.data());
+	extra_len = std::min<size_t>(history.extra.size(), extra.size());
+	std::copy_n(history.extra.data(), extra_len, extra.data());
+}
+
+/**
+ * Handle histories queued by the NimBLE host task in the main loop.
+ */
+void
+SesameLock::handle_history_events() {
+	if (auto overflows = history->events.get_overflows(); overflows != history->reported_overflows) {
+		ESP_LOGW(TAG, "%lu histories dropped", overflows - history->reported_overflows);
+		history->reported_overflows = overflows;
+	}
+	history_record record;
+	while (history->events.pop(record)) {
+		handle_history(record);
+	}
+}
+
+void
+SesameLock::handle_history(const history_record& history) {
+	if (is_bot1()) {
+		handle_bot_history(history);
+		return;
+	}
+	if (history.result != Sesame::result_code_t::success) {
+		finish_history_drain();
+		return;
+	}
+	// drive_* records follow the record of the operation that moved the motor, keep the values (tag, trigger) of that one
+	if (auto& hset = get_history_set(); hset.using_history() && history.type != Sesame::history_type_t::drive_locked &&
+	                                    history.type != Sesame::history_type_t::drive_unlocked &&
+	                                    history.type != Sesame::history_type_t::drive_clicked) {
+		hset.save_received_values(history);
+	}
+	if (timers.armed(lock_timer_t::history) && history_type_matched(lock_state, history.type)) {
+		timers.cancel(lock_timer_t::history);
+		publish_lock_history_state();
+	}
+	auto& all_hset = get_all_history_set();
+	if (!all_hset.using_history()) {
+		return;
+	}
+	// Record ids (also the persisted one) only prevent publishing the same record twice to all_history_*
+	if (is_known_record(history.record_id)) {
+		ESP_LOGD(TAG, "History record %ld already received", static_cast<long>(history.record_id));
+		// Caught up with records already received
+		finish_history_drain();
+		return;
+	}
+	all_hset.save_received_values(history);
+	publish_all_history_state();
+	// Request the next one after publishing so that records are published one by one in order
+	request_next_history();
+}
+
+/**
+ * Remember `record_id` and tell whether it has been received already (recently or before reboot).
+ */
+bool
+SesameLock::is_known_record(int32_t record_id) {
+	auto& h = *history;
+	auto end = std::cbegin(h.recent_record_ids) + h.recent_record_count;
+	if (std::find(std::cbegin(h.recent_record_ids), end, record_id) != end) {
+		return true;
+	}
+	if (h.last_record_id && record_id <= *h.last_record_id && *h.last_record_id - record_id < RECORD_ID_WINDOW) {
+		return true;
+	}
+	h.recent_record_ids[h.recent_record_pos] = record_id;
+	h.recent_record_pos = (h.recent_record_pos + 1) % h.recent_record_ids.size();
+	h.recent_record_count = std::min<size_t>(h.recent_record_count + 1, h.recent_record_ids.size());
+	h.last_record_id = record_id;
+	if (++h.unsaved_records >= RECORD_ID_SAVE_COUNT) {
+		save_last_record_id();
+	} else if (h.unsaved_records == 1) {
+		timers.arm(lock_timer_t::record_id_save, millis(), RECORD_ID_SAVE_DELAY);
+	}
+	return false;
+}
+
+void
+SesameLock::load_last_record_id() {
+	history->record_id_loaded = true;
+	if (!get_all_history_set().using_history()) {
+		return;
+	}
+	history->record_id_pref = global_preferences->make_preference<int32_t>(fnv1_hash(std::string{"sesame_record_id_"} + TAG), true);
+	if (int32_t id; history->record_id_pref.load(&id)) {
+		history->last_record_id = id;
+		ESP_LOGD(TAG, "Last history record_id=%ld", static_cast<long>(id));
+	}
+}
+
+/**
+ * Write the last record_id once per `RECORD_ID_SAVE_COUNT` records or `RECORD_ID_SAVE_DELAY` to spare flash.
+ */
+void
+SesameLock::save_last_record_id() {
+	timers.cancel(lock_timer_t::record_id_save);
+	if (!history->unsaved_records || !history->last_record_id) {
+		return;
+	}
+	history->record_id_pref.save(&*history->last_record_id);
+	history->unsaved_records = 0;
+}
+
+/**
+ * Receive histories recorded while disconnected one after another until SESAME reports no more history.
+ * Each request returns the oldest record not sent yet, so records arrive in ascending record_id. A record already
+ * received also ends the drain, and so does a response not received within HISTORY_TIMEOUT.
+ */
+void
+SesameLock::start_history_drain() {
+	history->drained = 0;
+	if (!parent_->sesame.request_history()) {
+		ESP_LOGW(TAG, "Failed to request history");
+		return;
+	}
+	ESP_LOGD(TAG, "Receiving history backlog");
+	history->draining = true;
+	timers.arm(lock_timer_t::history_drain, millis(), HISTORY_TIMEOUT);
+}
+
+void
+SesameLock::request_next_history() {
+	if (!history->draining) {
+		return;
+	}
+	if (++history->drained >= MAX_HISTORY_DRAIN) {
+		ESP_LOGW(TAG, "History backlog exceeds %u records, remaining records are left", MAX_HISTORY_DRAIN);
+		finish_history_drain();
+		return;
+	}
+	if (!parent_->sesame.request_history()) {
+		ESP_LOGW(TAG, "Failed to request history");
+		finish_history_drain();
+		return;
+	}
+	timers.arm(lock_timer_t::history_drain, millis(), HISTORY_TIMEOUT);
+}
+
+void
+SesameLock::finish_history_drain() {
+	timers.cancel(lock_timer_t::history_drain);
+	if (history->draining) {
+		ESP_LOGD(TAG, "History backlog received (%u records)", history->drained);
+		history->draining = false;
+	}
+}
+
 void
 SesameLock::test_unknown_state() {
 	if (parent_->sesame_status.has_value()) {
-		unknown_state_started = 0;
+		timers.cancel(lock_timer_t::unknown_state);
 	} else {
-		if (lock_state != lock::LOCK_STATE_NONE) {
+		if (lock_state != lock::LOCK_STATE_NONE && unknown_state_timeout) {
 			auto now = esphome::millis();
-			if (unknown_state_started == 0) {
-				unknown_state_started = now;
-			} else if (unknown_state_timeout && now - unknown_state_started > unknown_state_timeout) {
+			if (!timers.armed(lock_timer_t::unknown_state)) {
+				timers.arm(lock_timer_t::unknown_state, now, unknown_state_timeout);
+			} else if (timers.expire(lock_timer_t::unknown_state, now)) {
 				update_lock_state(lock::LOCK_STATE_NONE);
-				if (auto& hset = get_history_set(); hset.using_history()) {
-					hset.clear_received_values();
-					hset.set_history_sensors();
-					hset.publish_history_sensors();
+				if (using_history()) {
+					for (auto& hset : history->sets) {
+						if (hset.using_history()) {
+							hset.clear_received_values();
+							hset.set_history_sensors();
+							hset.publish_history_sensors();
+						}
+					}
 				}
-				if (auto& hset = get_all_history_set(); hset.using_history()) {
-					hset.clear_received_values();
-					hset.set_history_sensors();
-					hset.publish_history_sensors();
-				}
-				unknown_state_started = 0;
 			}
 		}
 	}
 }
 
 void
-SesameLock::handle_bot_history(const SesameClient::History& history) {
+SesameLock::handle_bot_history(const history_record& history) {
 	if (history.result == Sesame::result_code_t::success) {
 		if (history.type == Sesame::history_type_t::drive_locked || history.type == Sesame::history_type_t::drive_unlocked ||
 		    history.type == Sesame::history_type_t::drive_clicked) {
 		} else {
 			if (auto& hset = get_history_set(); hset.using_history()) {
-				hset.save_received_values(history.type, history.history_tag_type, std::string_view{history.tag, history.tag_len},
-				                          history.scaled_voltage, history.scaled_voltage2, history.extra);
+				hset.save_received_values(history);
 				hset.set_history_sensors();
 				hset.publish_history_sensors();
 			}
 		}
-		if (history_timeout_started > 0) {
-			history_timeout_started = 0;
-			parent_->defer([this]() { publish_lock_history_state(); });
+		if (timers.armed(lock_timer_t::history)) {
+			timers.cancel(lock_timer_t::history);
+			publish_lock_history_state();
 			return;
 		}
 	} else if (history.result == Sesame::result_code_t::not_found) {
-		if (history_timeout_started > 0) {
-			history_timeout_started = 0;
-			parent_->defer([this]() { publish_lock_history_state(); });
+		if (timers.armed(lock_timer_t::history)) {
+			timers.cancel(lock_timer_t::history);
+			publish_lock_history_state();
 			return;
 		}
 	} else {
-		if (history_timeout_started > 0) {
+		if (timers.armed(lock_timer_t::history)) {
 			parent_->set_timeout(300, [this]() {
 				parent_->sesame.request_history();
 				ESP_LOGD(TAG, "re request history");
@@ -140,22 +319,19 @@ SesameLock::is_bot1() const {
 }
 
 void
-SesameLock::test_timeout() {
-	auto now = esphome::millis();
-	if (HISTORY_TIMEOUT) {
-		if (history_timeout_started && now - history_timeout_started > HISTORY_TIMEOUT) {
-			ESP_LOGW(TAG, "History receive timeout");
-			history_timeout_started = 0;
-			get_history_set().clear_received_values();
-			publish_lock_history_state();
-		}
+SesameLock::test_timeout(uint32_t now) {
+	if (using_history() && timers.expire(lock_timer_t::history_drain, now)) {
+		ESP_LOGW(TAG, "History backlog not received in time");
+		finish_history_drain();
 	}
-	if (JAMM_DETECTION_TIMEOUT) {
-		if (jam_detection_started && now - jam_detection_started > JAMM_DETECTION_TIMEOUT) {
-			ESP_LOGW(TAG, "Locking state not determined too long, treat as jammed");
-			jam_detection_started = 0;
-			update_lock_state(LockState::LOCK_STATE_JAMMED);
-		}
+	if (using_history() && timers.expire(lock_timer_t::history, now)) {
+		ESP_LOGW(TAG, "History receive timeout");
+		get_history_set().clear_received_values();
+		publish_lock_history_state();
+	}
+	if (timers.expire(lock_timer_t::jam_detection, now)) {
+		ESP_LOGW(TAG, "Locking state not determined too long, treat as jammed");
+		update_lock_state(LockState::LOCK_STATE_JAMMED);
 	}
 }
 
@@ -179,32 +355,17 @@ SesameLock::publish_lock_state(bool force_publish) {
 
 void
 SesameLock::lock(std::string_view tag) {
-	if (!operable_warn()) {
-		return;
-	}
-	if (!parent_->sesame.lock(tag)) {
-		ESP_LOGW(TAG, "Failed to send lock command");
-	}
+	submit_command({lock_command::type_t::lock, tag});
 }
 
 void
 SesameLock::unlock(std::string_view tag) {
-	if (!operable_warn()) {
-		return;
-	}
-	if (!parent_->sesame.unlock(tag)) {
-		ESP_LOGW(TAG, "Failed to send unlock command");
-	}
+	submit_command({lock_command::type_t::unlock, tag});
 }
 
 void
 SesameLock::open(std::string_view tag) {
-	if (!operable_warn()) {
-		return;
-	}
-	if (!parent_->sesame.click(tag)) {
-		ESP_LOGW(TAG, "Failed to send click command");
-	}
+	submit_command({lock_command::type_t::click, tag});
 }
 
 static int8_t
@@ -238,42 +399,196 @@ hex2bin(std::string_view str, std::byte* out, size_t limit) {
 }
 
 void
-SesameLock::lock(float history_tag_type, std::string_view tag) {
-	if (!operable_warn()) {
-		return;
-	}
+SesameLock::submit_command(lock_command::type_t type, float history_tag_type, std::string_view tag) {
 	if (std::isnan(history_tag_type)) {
-		parent_->sesame.lock(tag);
+		submit_command({type, tag});
 		return;
 	}
-	std::array<std::byte, libsesame3bt::HISTORY_TAG_UUID_SIZE> uuid;
-	if (hex2bin(tag, uuid.data(), uuid.size()) == false) {
+	lock_command command{type, {}};
+	if (hex2bin(tag, command.uuid.data(), command.uuid.size()) == false) {
 		ESP_LOGW(TAG, "Invalid history tag format, must be hex string");
 		return;
 	}
-	parent_->sesame.lock(static_cast<history_tag_type_t>(history_tag_type), uuid);
+	command.history_tag_type = static_cast<history_tag_type_t>(history_tag_type);
+	submit_command(command);
 }
 
+/**
+ * Send the command now if connected. Otherwise keep it (replacing any older one) until connected or
+ * `command_queue_timeout` expires, and ask for a prioritized connection.
+ */
 void
-SesameLock::unlock(float history_tag_type, std::string_view tag) {
-	if (!operable_warn()) {
+SesameLock::submit_command(const lock_command& command) {
+	if (parent_->my_state == state_t::running) {
+		pending_command.type = lock_command::type_t::none;
+		send_command(command);
 		return;
 	}
-	if (std::isnan(history_tag_type)) {
-		parent_->sesame.lock(tag);
+	if (!command_queue_timeout) {
+		ESP_LOGW(TAG, "Not connected to SESAME yet, ignored requested action");
+		parent_->request_connect(connect_priority_t::command);
 		return;
 	}
-	std::array<std::byte, libsesame3bt::HISTORY_TAG_UUID_SIZE> uuid;
-	if (hex2bin(tag, uuid.data(), uuid.size()) == false) {
-		ESP_LOGW(TAG, "Invalid history tag format, must be hex string");
+	if (pending_command.type != lock_command::type_t::none) {
+		ESP_LOGD(TAG, "Pending %s command replaced by %s", pending_command.type_str(), command.type_str());
+	}
+	parent_->wake_loop();
+	pending_command = command;
+	pending_command.queued = millis();
+	ESP_LOGI(TAG, "Not connected to SESAME yet, %s command queued", command.type_str());
+	parent_->set_command_in_progress(true);
+	parent_->request_connect(connect_priority_t::command);
+}
+
+void
+SesameLock::send_command(const lock_command& command) {
+	auto& sesame = parent_->sesame;
+	bool sent = false;
+	switch (command.type) {
+		case lock_command::type_t::lock:
+			sent = command.history_tag_type ? sesame.lock(*command.history_tag_type, command.uuid) : sesame.lock(command.get_tag());
+			break;
+		case lock_command::type_t::unlock:
+			sent =
+			    command.history_tag_type ? sesame.unlock(*command.history_tag_type, command.uuid) : sesame.unlock(command.get_tag());
+			break;
+		case lock_command::type_t::click:
+			sent = sesame.click(command.get_tag());
+			break;
+		case lock_command::type_t::none:
+			return;
+	}
+	if (!sent) {
+		ESP_LOGW(TAG, "Failed to send %s command", command.type_str());
+		finish_command();
+		return;
+	}
+	++sent_commands;
+	auto now = millis();
+	timers.arm(lock_timer_t::command, now, MOVING_TIMEOUT);
+	parent_->set_command_in_progress(true);
+	start_command_latency(command.type);
+	if (command.publish_moving) {
+		publish_state(command.type == lock_command::type_t::lock ? lock::LOCK_STATE_LOCKING : lock::LOCK_STATE_UNLOCKING);
+		timers.arm(lock_timer_t::moving_state, now, MOVING_TIMEOUT);
+	}
+}
+
+lock_history&
+SesameLock::get_history() {
+	if (!history) {
+		history = std::make_unique<lock_history>();
+	}
+	return *history;
+}
+
+SesameLock::command_latency_t&
+SesameLock::get_command_latency() {
+	if (!command_latency) {
+		command_latency = std::make_unique<command_latency_t>();
+	}
+	return *command_latency;
+}
+
+void
+SesameLock::start_command_latency(lock_command::type_t type) {
+	if (!command_latency || (type != lock_command::type_t::lock && type != lock_command::type_t::unlock)) {
+		return;
+	}
+	auto& cl = *command_latency;
+	cl.sent = millis();
+	cl.type = type;
+	cl.acked = false;
+	const auto& sesame_status = parent_->sesame_status;
+	cl.target_at_send = sesame_status ? std::make_optional(sesame_status->target()) : std::nullopt;
+}
+
+/**
+ * Called on each status while a lock/unlock command is in flight.
+ * Acknowledged: first status whose target differs from the one at send time (or the first status at all if none was known).
+ * Settled: the lock reached the requested state.
+ */
+void
+SesameLock::measure_command_latency() {
+	if (!command_latency || command_latency->type == lock_command::type_t::none) {
+		return;
+	}
+	auto& cl = *command_latency;
+	const auto& sesame_status = parent_->sesame_status;
+	auto elapsed = millis() - cl.sent;
+	if (!sesame_status || elapsed > COMMAND_LATENCY_TIMEOUT) {
+		cl.type = lock_command::type_t::none;
 		return;
 	}
-	parent_->sesame.unlock(static_cast<history_tag_type_t>(history_tag_type), uuid);
+	if (!cl.acked && (!cl.target_at_send || *cl.target_at_send != sesame_status->target() ||
+	                  sesame_status->motor_status() != Sesame::motor_status_t::idle)) {
+		cl.acked = true;
+		cl.ack_histogram.add(elapsed);
+		cl.ack.publish(cl.ack_histogram);
+		ESP_LOGD(TAG, "%s command acknowledged in %lu ms", cl.type == lock_command::type_t::lock ? "Lock" : "Unlock", elapsed);
+	}
+	bool settled = cl.type == lock_command::type_t::lock ? sesame_status->in_lock() && !sesame_status->in_unlock()
+	                                                     : sesame_status->in_unlock() && !sesame_status->in_lock();
+	if (cl.acked && settled) {
+		cl.type = lock_command::type_t::none;
+		cl.settle_histogram.add(elapsed);
+		cl.settle.publish(cl.settle_histogram);
+		ESP_LOGD(TAG, "Command completed in %lu ms", elapsed);
+	}
+}
+
+void
+SesameLock::test_pending_command() {
+	if (pending_command.type == lock_command::type_t::none) {
+		return;
+	}
+	if (parent_->my_state == state_t::running) {
+		ESP_LOGD(TAG, "Sending queued %s command (queued %lu ms)", pending_command.type_str(), millis() - pending_command.queued);
+		auto command = pending_command;
+		pending_command.type = lock_command::type_t::none;
+		send_command(command);
+	} else if (millis() - pending_command.queued > command_queue_timeout) {
+		ESP_LOGW(TAG, "Could not connect to SESAME in time, queued %s command dropped", pending_command.type_str());
+		pending_command.type = lock_command::type_t::none;
+		finish_command();
+	} else if (parent_->my_state == state_t::not_connected && parent_->requested_priority != connect_priority_t::command) {
+		// The priority is reset when a connection is admitted; if that attempt failed, retry at once for the command
+		parent_->request_connect(connect_priority_t::command);
+	}
+}
+
+/**
+ * Let an on-demand connection go once the sent command has taken effect (or could not be sent).
+ */
+void
+SesameLock::finish_command() {
+	timers.cancel(lock_timer_t::command);
+	parent_->set_command_in_progress(false);
+}
+
+lock_command::lock_command(type_t type, std::string_view tag, bool publish_moving) : type(type), publish_moving(publish_moving) {
+	tag_len = std::min(tag.size(), this->tag.size());
+	std::copy_n(tag.data(), tag_len, this->tag.data());
+}
+
+const char*
+lock_command::type_str() const {
+	switch (type) {
+		case type_t::lock:
+			return "lock";
+		case type_t::unlock:
+			return "unlock";
+		case type_t::click:
+			return "click";
+		default:
+			return "none";
+	}
 }
 
 void
 SesameLock::reflect_status_changed() {
 	const auto& sesame_status = parent_->sesame_status;
+	measure_command_latency();
 	if (!sesame_status) {
 		update_lock_state(LockState::LOCK_STATE_NONE);
 		return;
@@ -289,7 +604,8 @@ SesameLock::reflect_status_changed() {
 			return;
 		}
 	} else {
-		if (using_history()) {
+		// While draining, the history of this status is received as part of the backlog
+		if (using_history() && !draining_history()) {
 			if (parent_->sesame.request_history()) {
 				ESP_LOGD(TAG, "History requested");
 			} else {
@@ -297,14 +613,15 @@ SesameLock::reflect_status_changed() {
 				get_history_set().clear_received_values();
 			}
 		}
+		track_motion(*sesame_status);
 	}
 	if (sesame_status->in_lock() == sesame_status->in_unlock()) {
-		if (!jam_detection_started && lock_state != LockState::LOCK_STATE_JAMMED) {
-			jam_detection_started = esphome::millis();
+		if (!timers.armed(lock_timer_t::jam_detection) && lock_state != LockState::LOCK_STATE_JAMMED) {
+			timers.arm(lock_timer_t::jam_detection, esphome::millis(), JAMM_DETECTION_TIMEOUT);
 		}
 		return;
 	}
-	jam_detection_started = 0;
+	timers.cancel(lock_timer_t::jam_detection);
 	lock::LockState new_lock_state;
 	if (sesame_status->is_critical()) {
 		new_lock_state = lock::LOCK_STATE_JAMMED;
@@ -322,6 +639,9 @@ SesameLock::update_lock_state(lock::LockState new_state) {
 		return;
 	}
 	lock_state = new_state;
+	if (timers.armed(lock_timer_t::command)) {
+		finish_command();
+	}
 	if (lock_state == LockState::LOCK_STATE_NONE || lock_state == LockState::LOCK_STATE_JAMMED) {
 		publish_lock_state(is_bot1());
 	} else {
@@ -329,31 +649,84 @@ SesameLock::update_lock_state(lock::LockState new_state) {
 			publish_lock_state(is_bot1());
 		}
 		if (using_history()) {
-			history_timeout_started = millis();
+			timers.arm(lock_timer_t::history, millis(), HISTORY_TIMEOUT);
 		}
 	}
 }
 
+float
+history_set::battery_pct(float scaled_voltage) const {
+	if (!std::isfinite(scaled_voltage) || !recv_history_tag_type.has_value()) {
+		return NAN;
+	}
+	if (*recv_history_tag_type == history_tag_type_t::open_sensor || *recv_history_tag_type == history_tag_type_t::remote_nano) {
+		return Status::scaled_voltage_to_pct(scaled_voltage, Sesame::model_t::open_sensor_1);
+	}
+	return Status::scaled_voltage_to_pct(scaled_voltage, Sesame::model_t::sesame_5);
+}
+
 void
 history_set::set_battery_pct_sensor(sensor::Sensor* sensor, float scaled_voltage) {
-	if (!sensor) {
+	if (sensor) {
+		sensor->state = battery_pct(scaled_voltage);
+	}
+}
+
+/**
+ * Serialize received values as one compact JSON object (empty string if cleared), members without value are omitted.
+ */
+void
+history_set::set_history_event_sensor() {
+	if (recv_history_type == Sesame::history_type_t::none) {
+		history_event_sensor->state.clear();
 		return;
 	}
-	if (std::isfinite(scaled_voltage) && recv_history_tag_type.has_value()) {
-		if (*recv_history_tag_type == history_tag_type_t::open_sensor || *recv_history_tag_type == history_tag_type_t::remote_nano) {
-			sensor->state = Status::scaled_voltage_to_pct(scaled_voltage, Sesame::model_t::open_sensor_1);
+	std::array<char, MAX_HISTORY_EVENT_SIZE> buf;
+	size_t len = 0;
+	auto append = [&](const char* fmt, auto... args) {
+		if (len < buf.size()) {
+			auto n = std::snprintf(buf.data() + len, buf.size() - len, fmt, args...);
+			len = n < 0 ? buf.size() : std::min(len + n, buf.size() - 1);
+		}
+	};
+	append("{\"id\":%ld,\"type\":%u", static_cast<long>(recv_record_id), static_cast<uint8_t>(recv_history_type));
+	if (recv_history_tag_type) {
+		append(",\"tag_type\":%u", static_cast<uint8_t>(*recv_history_tag_type));
+	}
+	append(",\"tag\":\"");
+	for (char c : get_history_tag()) {
+		if (c == '"' || c == '\\') {
+			append("\\%c", c);
+		} else if (static_cast<uint8_t>(c) < 0x20) {
+			append("\\u%04x", static_cast<uint8_t>(c));
 		} else {
-			sensor->state = Status::scaled_voltage_to_pct(scaled_voltage, Sesame::model_t::sesame_5);
+			append("%c", c);
 		}
-	} else {
-		sensor->state = NAN;
 	}
+	append("\"");
+	auto append_voltage = [&](const char* suffix, float scaled_voltage) {
+		if (std::isfinite(scaled_voltage)) {
+			append(",\"voltage%s\":%.2f", suffix, scaled_voltage);
+			if (auto pct = battery_pct(scaled_voltage); std::isfinite(pct)) {
+				append(",\"battery_pct%s\":%.1f", suffix, pct);
+			}
+		}
+	};
+	append_voltage("", recv_scaled_voltage);
+	append_voltage("2", recv_scaled_voltage2);
+	if (recv_extra_len) {
+		std::array<char, MAX_HISTORY_EXTRA_SIZE * 2 + 1> hex;
+		hex[bin2hex(recv_extra.data(), recv_extra_len, hex.data())] = '\0';
+		append(",\"extra\":\"%s\"", hex.data());
+	}
+	append("}");
+	history_event_sensor->state.assign(buf.data(), len);
 }
 
 void
 history_set::set_history_sensors() {
 	if (history_tag_sensor) {
-		history_tag_sensor->state = recv_history_tag;
+		history_tag_sensor->state.assign(recv_history_tag.data(), recv_history_tag_len);
 	}
 	if (history_tag_type_sensor) {
 		history_tag_type_sensor->state = recv_history_tag_type.has_value() ? static_cast<uint8_t>(*recv_history_tag_type) : NAN;
@@ -369,8 +742,12 @@ history_set::set_history_sensors() {
 		history_scaled_voltage2_sensor->state = recv_scaled_voltage2;
 	}
 	set_battery_pct_sensor(history_battery_pct2_sensor, recv_scaled_voltage2);
+	if (history_event_sensor) {
+		set_history_event_sensor();
+	}
 	if (history_extra_sensor) {
-		history_extra_sensor->state = util::bin2hex(recv_extra.data(), recv_extra.size());
+		std::array<char, MAX_HISTORY_EXTRA_SIZE * 2> hex;
+		history_extra_sensor->state.assign(hex.data(), bin2hex(recv_extra.data(), recv_extra_len, hex.data()));
 	}
 }
 
@@ -385,21 +762,17 @@ history_set::publish_history_sensors() {
 	if (history_type_sensor) {
 		history_type_sensor->publish_state(history_type_sensor->state);
 	}
-	if (history_scaled_voltage_sensor) {
-		history_scaled_voltage_sensor->publish_state(history_scaled_voltage_sensor->state);
-	}
-	if (history_battery_pct_sensor) {
-		history_battery_pct_sensor->publish_state(history_battery_pct_sensor->state);
-	}
-	if (history_scaled_voltage2_sensor) {
-		history_scaled_voltage2_sensor->publish_state(history_scaled_voltage2_sensor->state);
-	}
-	if (history_battery_pct2_sensor) {
-		history_battery_pct2_sensor->publish_state(history_battery_pct2_sensor->state);
-	}
+	auto now = millis();
+	scaled_voltage_filter.publish(history_scaled_voltage_sensor, now);
+	battery_pct_filter.publish(history_battery_pct_sensor, now);
+	scaled_voltage2_filter.publish(history_scaled_voltage2_sensor, now);
+	battery_pct2_filter.publish(history_battery_pct2_sensor, now);
 	if (history_extra_sensor) {
 		history_extra_sensor->publish_state(history_extra_sensor->state);
 	}
+	if (history_event_sensor) {
+		history_event_sensor->publish_state(history_event_sensor->state);
+	}
 }
 
 void
@@ -447,80 +820,190 @@ void
 history_set::clear_received_values() {
 	recv_history_type = Sesame::history_type_t::none;
 	recv_history_tag_type = std::nullopt;
-	recv_history_tag.clear();
+	recv_history_tag_len = 0;
 	recv_scaled_voltage = NAN;
 	recv_scaled_voltage2 = NAN;
-	recv_extra.clear();
+	recv_extra_len = 0;
+}
+
+/**
+ * Battery values of histories are filtered like the battery sensors of the component. Tag and type are always published
+ * since each history is an event.
+ */
+void
+history_set::configure_filters(float pct_threshold, float voltage_threshold, uint32_t max_interval, uint32_t* suppressed) {
+	scaled_voltage_filter.configure(voltage_threshold, max_interval, suppressed);
+	battery_pct_filter.configure(pct_threshold, max_interval, suppressed);
+	scaled_voltage2_filter.configure(voltage_threshold, max_interval, suppressed);
+	battery_pct2_filter.configure(pct_threshold, max_interval, suppressed);
+}
+
+/**
+ * Reserve text sensor states so that assigning received values does not allocate.
+ */
+void
+history_set::reserve_buffers() {
+	if (history_tag_sensor) {
+		history_tag_sensor->state.reserve(MAX_HISTORY_TAG_SIZE);
+	}
+	if (history_extra_sensor) {
+		history_extra_sensor->state.reserve(MAX_HISTORY_EXTRA_SIZE * 2);
+	}
+	if (history_event_sensor) {
+		history_event_sensor->state.reserve(MAX_HISTORY_EVENT_SIZE);
+	}
+}
+
+size_t
+history_set::buffer_size() const {
+	size_t size = 0;
+	for (auto* sensor : {history_tag_sensor, history_extra_sensor, history_event_sensor}) {
+		if (sensor) {
+			size += sensor->state.capacity();
+		}
+	}
+	return size;
 }
 
 void
 SesameLock::loop() {
+	if (using_history()) {
+		handle_history_events();
+		if (!history->record_id_loaded) {
+			load_last_record_id();
+		}
+	}
+	test_pending_command();
 	test_unknown_state();
-	if (parent_->my_state == state_t::running) {
-		test_timeout();
-		test_moving_state();
+	bool running = parent_->my_state == state_t::running;
+	if (running != was_running) {
+		was_running = running;
+		if (running && !is_bot1() && using_history() && get_all_history_set().using_history()) {
+			start_history_drain();
+		} else if (!running) {
+			if (using_history()) {
+				history->draining = false;
+			}
+			timers.cancel(lock_timer_t::history_drain);
+			timers.cancel(lock_timer_t::jam_detection);
+			timers.cancel(lock_timer_t::stall);
+			motion_position.reset();
+		}
+	}
+	auto now = millis();
+	if (!timers.any_expired(now)) {
+		return;
+	}
+	if (using_history() && timers.expire(lock_timer_t::record_id_save, now)) {
+		save_last_record_id();
 	}
+	test_timeout(now);
+	test_moving_state(now);
+	test_stall(now);
 }
 
-void
-SesameLock::test_moving_state() {
-	if (state == lock::LOCK_STATE_LOCKING || state == lock::LOCK_STATE_UNLOCKING) {
-		if (moving_state_started > 0 && millis() - moving_state_started > MOVING_TIMEOUT) {
-			publish_lock_state(lock_state);
-			moving_state_started = 0;
+/**
+ * True if no timer is running and nothing is queued, so that the main loop of the component can sleep.
+ */
+bool
+SesameLock::is_idle() const {
+	// Saving the record_id is not urgent, the periodic wake-up of the component handles it
+	return pending_command.type == lock_command::type_t::none && !timers.any_armed_except(lock_timer_t::record_id_save) &&
+	       (!command_latency || command_latency->type == lock_command::type_t::none) &&
+	       was_running == (parent_->my_state == state_t::running) &&
+	       (!using_history() || (!history->draining && history->events.empty() && history->record_id_loaded));
+}
+
+/**
+ * Heap held by this lock, including text sensor states reserved for history values.
+ */
+size_t
+SesameLock::heap_usage() const {
+	size_t size = command_latency ? sizeof(command_latency_t) : 0;
+	if (history) {
+		size += sizeof(lock_history);
+		for (const auto& hs : history->sets) {
+			size += hs.buffer_size();
 		}
 	}
+	return size;
 }
 
 void
-SesameLock::publish_initial_state() {
-	publish_lock_state(true);
+SesameLock::test_moving_state(uint32_t now) {
+	if (timers.expire(lock_timer_t::moving_state, now) &&
+	    (state == lock::LOCK_STATE_LOCKING || state == lock::LOCK_STATE_UNLOCKING)) {
+		publish_lock_state(lock_state);
+	}
+	if (timers.expire(lock_timer_t::command, now)) {
+		finish_command();
+	}
 }
 
+/**
+ * While the motor is running, restart the stall timer each time the position changes.
+ */
 void
-SesameLock::open_latch() {
-	if (!operable_warn()) {
+SesameLock::track_motion(const Status& status) {
+	if (!stall_timeout) {
 		return;
 	}
-	if (is_bot1()) {
-		parent_->sesame.click(default_history_tag);
-	} else {
-		unlock();
+	if (status.motor_status() == Sesame::motor_status_t::idle || status.motor_status() == Sesame::motor_status_t::holding) {
+		timers.cancel(lock_timer_t::stall);
+		motion_position.reset();
+		return;
+	}
+	if (motion_position != status.position()) {
+		motion_position = status.position();
+		timers.arm(lock_timer_t::stall, millis(), stall_timeout);
 	}
 }
 
-bool
-SesameLock::operable_warn() const {
-	if (parent_->my_state != state_t::running) {
-		ESP_LOGW(TAG, "Not connected to SESAME yet, ignored requested action");
-		return false;
+/**
+ * Motor still running without moving for `stall_timeout` short of the target: jammed without waiting for
+ * `JAMM_DETECTION_TIMEOUT`.
+ */
+void
+SesameLock::test_stall(uint32_t now) {
+	if (!timers.expire(lock_timer_t::stall, now)) {
+		return;
 	}
-	return true;
+	const auto& sesame_status = parent_->sesame_status;
+	if (!sesame_status || !motion_position || *motion_position == sesame_status->target()) {
+		return;
+	}
+	ESP_LOGW(TAG, "Motor stalled at %d (target %d), treat as jammed", *motion_position, sesame_status->target());
+	if (stall_position_sensor) {
+		stall_position_sensor->publish_state(*motion_position);
+	}
+	motion_position.reset();
+	timers.cancel(lock_timer_t::jam_detection);
+	update_lock_state(LockState::LOCK_STATE_JAMMED);
 }
 
 void
-SesameLock::control(const lock::LockCall& call) {
-	if (!operable_warn()) {
-		return;
+SesameLock::publish_initial_state() {
+	publish_lock_state(true);
+}
+
+void
+SesameLock::open_latch() {
+	if (is_bot1()) {
+		submit_command({lock_command::type_t::click, default_history_tag});
+	} else {
+		unlock();
 	}
+}
 
+void
+SesameLock::control(const lock::LockCall& call) {
 	if (call.get_state()) {
 		auto tobe = *call.get_state();
 
 		if (tobe == lock::LOCK_STATE_LOCKED) {
-			if (parent_->sesame.lock(default_history_tag)) {
-				publish_state(lock::LOCK_STATE_LOCKING);
-				moving_state_started = millis();
-			} else {
-				ESP_LOGW(TAG, "Failed to send lock command");
-			}
+			submit_command({lock_command::type_t::lock, default_history_tag, true});
 		} else if (tobe == lock::LOCK_STATE_UNLOCKED) {
-			if (parent_->sesame.unlock(default_history_tag)) {
-				publish_state(lock::LOCK_STATE_UNLOCKING);
-				moving_state_started = millis();
-			} else {
-				ESP_LOGW(TAG, "Failed to send unlock command");
-			}
+			submit_command({lock_command::type_t::unlock, default_history_tag, true});
 		}
 	}
 }
@@ -6,15 +6,50 @@
 #include <esphome/components/sensor/sensor.h>
 #include <esphome/components/text_sensor/text_sensor.h>
 #include <esphome/core/component.h>
+#include <esphome/core/defines.h>
+#include <esphome/core/preferences.h>
+#include <algorithm>
+#include <array>
 #include <cmath>
+#include <memory>
 #include <optional>
 #include <string_view>
 #include "feature.h"
+#include "deadlines.h"
+#include "event_ring.h"
+#include "latency_stats.h"
+#include "publish_filter.h"
 
 namespace esphome {
 namespace sesame_lock {
 
+inline constexpr size_t MAX_HISTORY_TAG_SIZE = libsesame3bt::SesameClient::MAX_CMD_TAG_SIZE;
+inline constexpr size_t MAX_HISTORY_EXTRA_SIZE = 32;
+
+/**
+ * Copy of SesameClient::History that can be queued without allocation.
+ */
+struct history_record {
+	int32_t record_id = 0;
+	libsesame3bt::Sesame::result_code_t result{};
+	libsesame3bt::Sesame::history_type_t type = libsesame3bt::Sesame::history_type_t::none;
+	std::optional<libsesame3bt::history_tag_type_t> history_tag_type;
+	float scaled_voltage = NAN;
+	float scaled_voltage2 = NAN;
+	uint8_t tag_len = 0;
+	uint8_t extra_len = 0;
+	std::array<char, MAX_HISTORY_TAG_SIZE> tag;
+	std::array<char, MAX_HISTORY_EXTRA_SIZE> extra;
+
+	history_record() = default;
+	history_record(const libsesame3bt::SesameClient::History& history);
+	std::string_view get_tag() const { return {tag.data(), tag_len}; }
+	std::string_view get_extra() const { return {extra.data(), extra_len}; }
+};
+
 struct history_set {
+	static constexpr size_t MAX_HISTORY_EVENT_SIZE = 384;
+
 	text_sensor::TextSensor* history_tag_sensor = nullptr;
 	sensor::Sensor* history_type_sensor = nullptr;
 	sensor::Sensor* history_tag_type_sensor = nullptr;
@@ -23,44 +58,87 @@ struct history_set {
 	sensor::Sensor* history_scaled_voltage2_sensor = nullptr;
 	sensor::Sensor* history_battery_pct2_sensor = nullptr;
 	text_sensor::TextSensor* history_extra_sensor = nullptr;
+	text_sensor::TextSensor* history_event_sensor = nullptr;
+	publish_filter scaled_voltage_filter;
+	publish_filter battery_pct_filter;
+	publish_filter scaled_voltage2_filter;
+	publish_filter battery_pct2_filter;
 
+	int32_t recv_record_id = 0;
 	libsesame3bt::Sesame::history_type_t recv_history_type = libsesame3bt::Sesame::history_type_t::none;
 	std::optional<libsesame3bt::history_tag_type_t> recv_history_tag_type = std::nullopt;
 	float recv_scaled_voltage = NAN;
 	float recv_scaled_voltage2 = NAN;
-	std::string recv_extra;
-	std::string recv_history_tag;
+	uint8_t recv_history_tag_len = 0;
+	uint8_t recv_extra_len = 0;
+	std::array<char, MAX_HISTORY_TAG_SIZE> recv_history_tag;
+	std::array<uint8_t, MAX_HISTORY_EXTRA_SIZE> recv_extra;
 
 	bool using_history() const {
 		return history_tag_sensor || history_type_sensor || history_tag_type_sensor || history_scaled_voltage_sensor ||
-		       history_battery_pct_sensor || history_scaled_voltage2_sensor || history_battery_pct2_sensor || history_extra_sensor;
-	}
-	void reserve_tag_buffer() {
-		if (using_history()) {
-			recv_history_tag.reserve(libsesame3bt::SesameClient::MAX_CMD_TAG_SIZE + 1);
-		}
+		       history_battery_pct_sensor || history_scaled_voltage2_sensor || history_battery_pct2_sensor || history_extra_sensor ||
+		       history_event_sensor;
 	}
-	void save_received_values(libsesame3bt::Sesame::history_type_t type,
-	                          std::optional<libsesame3bt::history_tag_type_t> tag_type,
-	                          std::string_view tag,
-	                          float scaled_voltage,
-	                          float scaled_voltage2,
-	                          std::string_view extra) {
-		recv_history_type = type;
-		recv_history_tag_type = tag_type;
-		recv_history_tag.assign(tag);
-		recv_scaled_voltage = scaled_voltage;
-		recv_scaled_voltage2 = scaled_voltage2;
-		recv_extra = extra;
+	void reserve_buffers();
+	void configure_filters(float pct_threshold, float voltage_threshold, uint32_t max_interval, uint32_t* suppressed);
+	void save_received_values(const history_record& history) {
+		recv_record_id = history.record_id;
+		recv_history_type = history.type;
+		recv_history_tag_type = history.history_tag_type;
+		recv_history_tag_len = history.tag_len;
+		std::copy_n(history.tag.data(), history.tag_len, recv_history_tag.data());
+		recv_scaled_voltage = history.scaled_voltage;
+		recv_scaled_voltage2 = history.scaled_voltage2;
+		recv_extra_len = history.extra_len;
+		std::copy_n(history.extra.data(), history.extra_len, recv_extra.data());
 	}
+	std::string_view get_history_tag() const { return {recv_history_tag.data(), recv_history_tag_len}; }
 	void set_history_sensors();
 	void publish_history_sensors();
 	void set_battery_pct_sensor(sensor::Sensor* sensor, float scaled_voltage);
+	void set_history_event_sensor();
+	float battery_pct(float scaled_voltage) const;
 	void clear_received_values();
+	size_t buffer_size() const;
+};
+
+/**
+ * History state of a lock, allocated only when history sensors are configured.
+ */
+struct lock_history {
+	history_set sets[2];
+	EventRing<history_record, 8> events;
+	std::array<int32_t, 8> recent_record_ids;
+	ESPPreferenceObject record_id_pref;
+	std::optional<int32_t> last_record_id;
+	uint32_t reported_overflows = 0;
+	uint8_t recent_record_pos = 0;
+	uint8_t recent_record_count = 0;
+	uint8_t drained = 0;
+	uint8_t unsaved_records = 0;
+	bool record_id_loaded = false;
+	bool draining = false;
+};
+
+struct lock_command {
+	enum class type_t : uint8_t { none, lock, unlock, click };
+
+	type_t type = type_t::none;
+	bool publish_moving = false;
+	uint8_t tag_len = 0;
+	uint32_t queued = 0;
+	std::optional<libsesame3bt::history_tag_type_t> history_tag_type;
+	std::array<char, libsesame3bt::SesameClient::MAX_CMD_TAG_SIZE> tag;
+	std::array<std::byte, libsesame3bt::HISTORY_TAG_UUID_SIZE> uuid;
+
+	lock_command() = default;
+	lock_command(type_t type, std::string_view tag, bool publish_moving = false);
+	std::string_view get_tag() const { return {tag.data(), tag_len}; }
+	const char* type_str() const;
 };
 
 class SesameComponent;
-class SesameLock : public lock::Lock, public Feature {
+class SesameLock final : public lock::Lock, public Feature {
 	friend class SesameComponent;
 
  public:
@@ -73,9 +151,9 @@ class SesameLock : public lock::Lock, public Feature {
 	void lock(StringRef tag) { lock(std::string_view{tag.c_str(), tag.size()}); }
 	void unlock(std::string_view tag);
 	void unlock(StringRef tag) { unlock(std::string_view{tag.c_str(), tag.size()}); }
-	void lock(float history_tag_type, std::string_view tag);
+	void lock(float history_tag_type, std::string_view tag) { submit_command(lock_command::type_t::lock, history_tag_type, tag); }
 	void lock(float history_tag_type, StringRef tag) { lock(history_tag_type, std::string_view{tag.c_str(), tag.size()}); }
-	void unlock(float history_tag_type, std::string_view tag);
+	void unlock(float history_tag_type, std::string_view tag) { submit_command(lock_command::type_t::unlock, history_tag_type, tag); }
 	void unlock(float history_tag_type, StringRef tag) { unlock(history_tag_type, std::string_view{tag.c_str(), tag.size()}); }
 	void open(std::string_view tag);
 	void open(StringRef tag) { open(std::string_view{tag.c_str(), tag.size()}); }
@@ -87,6 +165,7 @@ class SesameLock : public lock::Lock, public Feature {
 	void set_history_scaled_voltage2_sensor(sensor::Sensor* sensor) { set_history_scaled_voltage2_sensor(get_history_set(), sensor); }
 	void set_history_battery_pct2_sensor(sensor::Sensor* sensor) { set_history_battery_pct2_sensor(get_history_set(), sensor); }
 	void set_history_extra_sensor(text_sensor::TextSensor* sensor) { set_history_extra_sensor(get_history_set(), sensor); }
+	void set_history_event_sensor(text_sensor::TextSensor* sensor) { set_history_event_sensor(get_history_set(), sensor); }
 	void set_all_history_tag_sensor(text_sensor::TextSensor* sensor) { set_history_tag_sensor(get_all_history_set(), sensor); }
 	void set_all_history_type_sensor(sensor::Sensor* sensor) { set_history_type_sensor(get_all_history_set(), sensor); }
 	void set_all_history_tag_type_sensor(sensor::Sensor* sensor) { set_history_tag_type_sensor(get_all_history_set(), sensor); }
@@ -101,42 +180,110 @@ class SesameLock : public lock::Lock, public Feature {
 		set_history_battery_pct2_sensor(get_all_history_set(), sensor);
 	}
 	void set_all_history_extra_sensor(text_sensor::TextSensor* sensor) { set_history_extra_sensor(get_all_history_set(), sensor); }
+	void set_all_history_event_sensor(text_sensor::TextSensor* sensor) { set_history_event_sensor(get_all_history_set(), sensor); }
 	void set_unknown_state_alternative(lock::LockState alternative) { unknown_state_alternative = alternative; }
 	void set_unknown_state_timeout(uint32_t timeout) { unknown_state_timeout = timeout; }
 	void set_fast_notify(bool fast_notify) { this->fast_notify = fast_notify; }
+	void set_command_queue_timeout(uint32_t timeout) { command_queue_timeout = timeout; }
+	void set_stall_timeout(uint32_t timeout) { stall_timeout = timeout; }
+	void set_stall_position_sensor(sensor::Sensor* sensor) { stall_position_sensor = sensor; }
+	void set_publish_filter(float pct_threshold, float voltage_threshold, uint32_t max_interval);
+	void set_command_latency_sensor(latency_stat_t stat, sensor::Sensor* sensor) { get_command_latency().settle.set_sensor(stat, sensor); }
+	void set_command_ack_latency_sensor(latency_stat_t stat, sensor::Sensor* sensor) {
+		get_command_latency().ack.set_sensor(stat, sensor);
+	}
 	virtual void loop() override;
 	virtual void publish_initial_state() override;
 	virtual void reflect_status_changed() override;
+	virtual bool is_idle() const override;
+	virtual size_t object_size() const override { return sizeof(*this); }
+	virtual size_t heap_usage() const override;
+	// Incremented each time a command is sent to SESAME
+	uint16_t get_sent_commands() const { return sent_commands; }
 
  private:
 	SesameComponent* parent_;
 	const char* TAG;
 	const char* default_history_tag = "";
-	uint32_t jam_detection_started = 0;
-	uint32_t history_timeout_started = 0;
-	history_set hset[2];
+	enum class lock_timer_t : uint8_t {
+		jam_detection,
+		history,
+		unknown_state,
+		moving_state,
+		command,
+		record_id_save,
+		stall,
+		history_drain,
+		count
+	};
+	Deadlines<lock_timer_t> timers;
 	lock::LockState lock_state = lock::LockState::LOCK_STATE_NONE;
 	lock::LockState unknown_state_alternative = lock::LockState::LOCK_STATE_NONE;
-	uint32_t unknown_state_started = 0;
 	uint32_t unknown_state_timeout = 20'000;
-	uint32_t moving_state_started = 0;
+	uint32_t command_queue_timeout = 30'000;
+	uint32_t stall_timeout = 0;
+	sensor::Sensor* stall_position_sensor = nullptr;
+	std::optional<int16_t> motion_position;
+	uint16_t sent_commands = 0;
+	lock_command pending_command;
+	struct command_latency_t {
+		latency_histogram ack_histogram;
+		latency_histogram settle_histogram;
+		latency_sensors ack;
+		latency_sensors settle;
+		uint32_t sent = 0;
+		lock_command::type_t type = lock_command::type_t::none;
+		std::optional<int16_t> target_at_send;
+		bool acked = false;
+	};
+	std::unique_ptr<command_latency_t> command_latency;
+	std::unique_ptr<lock_history> history;
+	bool was_running = false;
 	bool motor_moved = false;
 	bool fast_notify = false;
 
 	virtual void control(const lock::LockCall& call) override;
 	virtual void open_latch() override;
-	bool operable_warn() const;
-	bool using_history() const { return get_history_set().using_history() || get_all_history_set().using_history(); }
-	void test_timeout();
+	void submit_command(const lock_command& command);
+	void submit_command(lock_command::type_t type, float history_tag_type, std::string_view tag);
+	void send_command(const lock_command& command);
+	void finish_command();
+	void test_pending_command();
+	command_latency_t& get_command_latency();
+	void start_command_latency(lock_command::type_t type);
+	void measure_command_latency();
+	/**
+	 * Constant false when no lock of the build has history sensors, so that history handling is compiled out.
+	 */
+	bool using_history() const {
+#ifdef USE_SESAME_LOCK_HISTORY
+		return history != nullptr;
+#else
+		return false;
+#endif
+	}
+	bool draining_history() const { return using_history() && history->draining; }
+	lock_history& get_history();
+	void test_timeout(uint32_t now);
 	void test_unknown_state();
-	void test_moving_state();
+	void test_moving_state(uint32_t now);
+	void track_motion(const libsesame3bt::SesameClient::Status& status);
+	void test_stall(uint32_t now);
 	void publish_lock_state(bool force_publish = false);
 	void update_lock_state(lock::LockState);
 	void publish_lock_history_state();
 	void publish_all_history_state();
 	bool history_type_matched(lock::LockState, libsesame3bt::Sesame::history_type_t);
 	void clear_history();
-	void handle_bot_history(const libsesame3bt::SesameClient::History& history);
+	void handle_history(const history_record& history);
+	void handle_history_events();
+	void handle_bot_history(const history_record& history);
+	bool is_known_record(int32_t record_id);
+	void load_last_record_id();
+	void save_last_record_id();
+	void start_history_drain();
+	void request_next_history();
+	void finish_history_drain();
 	bool is_bot1() const;
 	void set_battery_pct_sensor(sensor::Sensor* sensor, float scaled_voltage);
 	void set_history_sensors();
@@ -151,10 +298,9 @@ class SesameLock : public lock::Lock, public Feature {
 	}
 	void set_history_battery_pct2_sensor(history_set& hset, sensor::Sensor* sensor) { hset.history_battery_pct2_sensor = sensor; }
 	void set_history_extra_sensor(history_set& hset, text_sensor::TextSensor* sensor) { hset.history_extra_sensor = sensor; }
-	history_set& get_history_set() { return hset[0]; }
-	history_set& get_all_history_set() { return hset[1]; }
-	const history_set& get_history_set() const { return hset[0]; }
-	const history_set& get_all_history_set() const { return hset[1]; }
+	void set_history_event_sensor(history_set& hset, text_sensor::TextSensor* sensor) { hset.history_event_sensor = sensor; }
+	history_set& get_history_set() { return get_history().sets[0]; }
+	history_set& get_all_history_set() { return get_history().sets[1]; }
 };
 
 }  // namespace sesame_lock
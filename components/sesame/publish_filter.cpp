@@ -0,0 +1,33 @@
+#include "publish_filter.h"
+
+namespace esphome::sesame_lock {
+
+bool
+publish_filter::test(float value, uint32_t now) {
+	if (!suppressed) {
+		return true;
+	}
+	bool changed = std::isnan(value) ? !std::isnan(last_value) : std::isnan(last_value) || std::fabs(value - last_value) > threshold;
+	if (published && !changed && (!max_interval || now - last_published < max_interval)) {
+		++*suppressed;
+		return false;
+	}
+	published = true;
+	last_value = value;
+	last_published = now;
+	return true;
+}
+
+void
+publish_filter::publish(sensor::Sensor* sensor, uint32_t now) {
+	if (!sensor) {
+		return;
+	}
+	if (test(sensor->state, now)) {
+		sensor->publish_state(sensor->state);
+	} else {
+		sensor->state = last_value;
+	}
+}
+
+}  // namespace esphome::sesame_lock
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <esphome/components/sensor/sensor.h>
+#include <cmath>
+#include <cstdint>
+
+namespace esphome::sesame_lock {
+
+/**
+ * Suppress publishing a value that has not changed by more than `threshold` since the last published one,
+ * unless `max_interval` has passed. Disabled (every value passes) until configured.
+ */
+struct publish_filter {
+	float threshold = 0;
+	uint32_t max_interval = 0;
+	uint32_t* suppressed = nullptr;
+	float last_value = NAN;
+	uint32_t last_published = 0;
+	bool published = false;
+
+	void configure(float threshold, uint32_t max_interval, uint32_t* suppressed) {
+		this->threshold = threshold;
+		this->max_interval = max_interval;
+		this->suppressed = suppressed;
+	}
+	bool test(float value, uint32_t now);
+	// Publish the value set to `sensor->state` if it passes, otherwise put back the last published value
+	void publish(sensor::Sensor* sensor, uint32_t now);
+};
+
+}  // namespace esphome::sesame_lock
@@ -1,7 +1,11 @@
 #include "sesame_component.h"
 #include <esphome/core/application.h>
+#include <esphome/core/helpers.h>
 #include <esphome/core/log.h>
 #include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "adv_scanner.h"
 #if __has_include("../sesame_server/sesame_server_component.h")
 #include "../sesame_server/sesame_server_component.h"
 #else
@@ -21,13 +25,16 @@ class SesameServerComponent {
 
 namespace {
 
-constexpr uint32_t CONNECT_RETRY_INTERVAL = 3'000;
+constexpr uint8_t MAX_BACKOFF_SHIFT = 16;
 constexpr uint32_t CONNECT_STATE_TIMEOUT_MARGIN = 5'000;
 constexpr uint32_t AUTHENTICATE_TIMEOUT = 5'000;
 constexpr uint32_t REBOOT_DELAY_SEC = 5;
 constexpr uint32_t DISCONNECT_WAIT_TIMEOUT = 5'000;
-
-constexpr const char* STATIC_TAG = "sesame_lock";
+constexpr uint32_t RADIO_WAIT_TIMEOUT = 10'000;
+constexpr uint32_t CONNECT_ADVERTISEMENT_AGE = 15'000;
+constexpr uint32_t SUPPRESSED_PUBLISHES_REPORT_INTERVAL = 60'000;
+// Polling of SesameClient state and periodic checks continue at this interval while the loop is sleeping
+constexpr uint32_t IDLE_WAKE_INTERVAL = 1'000;
 
 }  // namespace
 
@@ -43,13 +50,37 @@ SesameComponent::global_init() {
 	if (global_initialized) {
 		return;
 	}
-	connect_queue.reserve(instance_count);
+	connect_scheduler.init(instance_count);
 	global_initialized = true;
 }
 
-SesameComponent::SesameComponent(const char* id) {
-	log_tag_string = id;
-	TAG = log_tag_string.c_str();
+static bool
+is_central_model(Sesame::model_t model) {
+	return model == Sesame::model_t::sesame_touch || model == Sesame::model_t::sesame_touch_pro || model == Sesame::model_t::remote ||
+	       model == Sesame::model_t::remote_nano || model == Sesame::model_t::open_sensor_1;
+}
+
+/**
+ * Parse textual UUID into bytes in the same order as parse_advertisement() reports.
+ */
+static void
+parse_uuid(std::string_view str, uint8_t* out) {
+	size_t n = 0;
+	for (char c : str) {
+		int8_t v = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+		if (v < 0) {
+			continue;
+		}
+		if (n >= 32) {
+			break;
+		}
+		out[n / 2] = (n % 2) ? (out[n / 2] | v) : (v << 4);
+		++n;
+	}
+}
+
+// `id` is a string literal in the generated code
+SesameComponent::SesameComponent(const char* id) : TAG(id) {
 	++instance_count;
 }
 
@@ -60,10 +91,12 @@ SesameComponent::init(model_t model,
                       std::string_view btaddr,
                       std::string_view uuid) {
 	sesame.set_connect_timeout(connection_timeout);
+	this->model = model;
+	this->pubkey = pubkey;
+	this->secret = secret;
 	if (!btaddr.empty()) {
 		ble_address = NimBLEAddress(std::string{btaddr}, BLE_ADDR_RANDOM);
-		if (!sesame.begin(ble_address, model)) {
-			ESP_LOGE(TAG, "Failed to SesameClient::begin. May be unsupported model.");
+		if (!begin_client(&ble_address)) {
 			mark_failed();
 			return;
 		}
@@ -72,25 +105,18 @@ SesameComponent::init(model_t model,
 		mark_failed();
 		return;
 	} else {
-		if (!sesame.begin(NimBLEUUID{std::string{uuid}}, model)) {
-			ESP_LOGE(TAG, "Failed to SesameClient::begin with uuid. May be unsupported model.");
+		uuid_str = uuid;
+		if (!begin_client(nullptr)) {
 			mark_failed();
 			return;
 		}
-	}
-	if (!sesame.set_keys(pubkey, secret)) {
-		ESP_LOGE(TAG, "Failed to set keys. Invalid pubkey or secret.");
-		mark_failed();
-		return;
+		parse_uuid(uuid, uuid_bin.data());
 	}
 	sesame.set_status_callback([this](auto& client, auto status) {
 		ESP_LOGD(TAG, "Status in_lock=%u,in_unlock=%u,tgt=%d,pos=%d,mot=%u,ret=%u", status.in_lock(), status.in_unlock(),
 		         status.target(), status.position(), static_cast<uint8_t>(status.motor_status()), status.ret_code());
-		sesame_status = status;
-		defer([this]() {
-			operation_requested.update_status = false;
-			reflect_sesame_status();
-		});
+		status_events.push(status);
+		wake_loop();
 	});
 	set_state(state_t::not_connected);
 }
@@ -102,10 +128,193 @@ SesameComponent::setup() {
 		feature->publish_initial_state();
 	}
 	BLEDevice::init("");
+	if (!uuid_str.empty()) {
+		load_cached_address();
+	}
+	if (active_interval) {
+		idle_interval = get_update_interval();
+		if (update_interval_sensor) {
+			update_interval_sensor->publish_state(idle_interval);
+		}
+	}
+	// SESAME Touch / Remote connected to SESAME Server do not advertise
+	if (passive || (!always_connect && !(server && is_central_model(model)))) {
+		advertisement_listener = true;
+		AdvertisementScanner::get().add_listener(this);
+	}
+	// Connect once the device is seen to get the first status, instead of waiting for update_interval
+	if (passive) {
+		operation_requested.update_status = true;
+	}
+#if ESPHOME_VERSION_CODE >= VERSION_CODE(2025, 7, 0)
+	// Registered once, so that going idle does not touch the scheduler
+	set_interval("wake", IDLE_WAKE_INTERVAL, [this]() { enable_loop(); });
+#endif
+	test_memory_budget();
+}
+
+void
+SesameComponent::dump_config() {
+	ESP_LOGCONFIG(TAG, "SESAME:");
+	ESP_LOGCONFIG(TAG, "  Model: %u", static_cast<uint8_t>(model));
+	ESP_LOGCONFIG(TAG, "  Memory: component=%lu, client=%lu, feature=%lu, heap=%lu bytes",
+	              static_cast<uint32_t>(sizeof(SesameComponent) - sizeof(sesame)), static_cast<uint32_t>(sizeof(sesame)),
+	              static_cast<uint32_t>(feature ? feature->object_size() : 0), static_cast<uint32_t>(heap_usage()));
+	if (memory_budget) {
+		ESP_LOGCONFIG(TAG, "  Memory budget: %lu bytes", memory_budget);
+	}
+}
+
+/**
+ * Heap held by this instance. Buffers of NimBLE (per connection) are not included.
+ */
+size_t
+SesameComponent::heap_usage() const {
+	return (phase_latency ? sizeof(phase_latency_t) : 0) + (feature ? feature->heap_usage() : 0);
+}
+
+size_t
+SesameComponent::memory_usage() const {
+	return sizeof(*this) + (feature ? feature->object_size() : 0) + heap_usage();
+}
+
+void
+SesameComponent::test_memory_budget() {
+	if (!memory_budget) {
+		return;
+	}
+	if (auto usage = memory_usage(); usage > memory_budget) {
+		ESP_LOGE(TAG, "Memory usage %lu bytes exceeds memory_budget %lu bytes", static_cast<uint32_t>(usage), memory_budget);
+		status_set_warning();
+	}
+}
+
+bool
+SesameComponent::is_advertisement_of(uint64_t address, const uint8_t* uuid) const {
+	if (uuid_str.empty()) {
+		return address == static_cast<uint64_t>(ble_address);
+	}
+	return std::memcmp(uuid, uuid_bin.data(), uuid_bin.size()) == 0;
+}
+
+/**
+ * Called from the NimBLE host task.
+ */
+void
+SesameComponent::handle_advertisement(uint8_t flags) {
+	advertisement_seen.store(std::max<uint32_t>(esphome::millis(), 1));
+	advertisement_flags.store(flags);
+}
+
+bool
+SesameComponent::advertised_within(uint32_t now, uint32_t age) const {
+	auto seen = advertisement_seen.load();
+	// Signed, as an advertisement received after `now` was read is newer than `now`
+	return seen && static_cast<int32_t>(now - seen) < static_cast<int32_t>(age);
+}
+
+/**
+ * In passive mode the last received status stays valid while the device keeps advertising.
+ */
+void
+SesameComponent::test_advertisement(uint32_t now) {
+	AdvertisementScanner::get().loop(now);
+	if (auto flags = advertisement_flags.load(); flags != reported_advertisement_flags) {
+		ESP_LOGD(TAG, "Advertisement flags changed %02x -> %02x", reported_advertisement_flags, flags);
+		reported_advertisement_flags = flags;
+	}
+	if (passive && my_state == state_t::not_connected && sesame_status && !advertised_within(now, advertisement_timeout)) {
+		ESP_LOGI(TAG, "No advertisement received for %lu ms, status is unknown", advertisement_timeout);
+		sesame_status.reset();
+		reflect_sesame_status();
+	}
+}
+
+/**
+ * Begin SesameClient with `address`, or with the configured UUID if `address` is null.
+ * The caller decides whether a failure is fatal.
+ */
+bool
+SesameComponent::begin_client(const NimBLEAddress* address) {
+	if (address) {
+		if (!sesame.begin(*address, model)) {
+			ESP_LOGE(TAG, "Failed to SesameClient::begin. May be unsupported model.");
+			return false;
+		}
+	} else if (!sesame.begin(NimBLEUUID{std::string{uuid_str}}, model)) {
+		ESP_LOGE(TAG, "Failed to SesameClient::begin with uuid. May be unsupported model.");
+		return false;
+	}
+	if (!sesame.set_keys(pubkey, secret)) {
+		ESP_LOGE(TAG, "Failed to set keys. Invalid pubkey or secret.");
+		return false;
+	}
+	return true;
+}
+
+void
+SesameComponent::load_cached_address() {
+	address_pref = global_preferences->make_preference<uint64_t>(fnv1_hash("sesame_address_" + std::string{uuid_str}), true);
+	if (!address_pref.load(&cached_address) || cached_address == 0) {
+		cached_address = 0;
+		return;
+	}
+	NimBLEAddress address{cached_address, BLE_ADDR_RANDOM};
+	if (begin_client(&address)) {
+		using_cached_address = true;
+		ESP_LOGD(TAG, "Using cached address %s", address.toString().c_str());
+		return;
+	}
+	ESP_LOGW(TAG, "Cached address not usable, use UUID");
+	fallback_to_uuid();
+}
+
+/**
+ * Forget the cached address and begin SesameClient with the UUID again.
+ */
+void
+SesameComponent::fallback_to_uuid() {
+	using_cached_address = false;
+	cached_address = 0;
+	address_pref.save(&cached_address);
+	if (!begin_client(nullptr)) {
+		mark_failed();
+	}
+}
+
+void
+SesameComponent::update_cached_address() {
+	if (uuid_str.empty() || using_cached_address || !sesame.get_ble_client()) {
+		return;
+	}
+	uint64_t address = sesame.get_ble_client()->getPeerAddress();
+	if (address == 0 || address == cached_address) {
+		return;
+	}
+	cached_address = address;
+	address_pref.save(&cached_address);
+	ESP_LOGD(TAG, "Address cached");
+}
+
+void
+SesameComponent::on_connect_failed() {
+	if (!using_cached_address) {
+		return;
+	}
+	ESP_LOGI(TAG, "Failed to connect with cached address, fallback to UUID");
+	fallback_to_uuid();
 }
 
 void
 SesameComponent::reflect_sesame_status() {
+	if (connect_requested && sesame_status && my_state == state_t::running) {
+		ESP_LOGD(TAG, "First status %lu ms after connect requested", esphome::millis() - connect_requested);
+		connect_requested = 0;
+	}
+	if (sesame_status && sesame_status->motor_status() != Sesame::motor_status_t::idle &&
+	    sesame_status->motor_status() != Sesame::motor_status_t::holding) {
+		note_activity();
+	}
 	// Update sensors without publishing state yet, so that callbacks can read the new values before they are published
 	if (pct_sensor) {
 		pct_sensor->state = sesame_status ? sesame_status->battery_pct() : NAN;
@@ -128,20 +337,103 @@ SesameComponent::reflect_sesame_status() {
 	}
 
 	// Now publish sensor states after all updates are done, so that callbacks only see the new values
-	if (pct_sensor) {
-		pct_sensor->publish_state(pct_sensor->state);
-	}
-	if (voltage_sensor) {
-		voltage_sensor->publish_state(voltage_sensor->state);
-	}
+	auto now = esphome::millis();
+	pct_filter.publish(pct_sensor, now);
+	voltage_filter.publish(voltage_sensor, now);
 	if (battery_critical_sensor) {
 		battery_critical_sensor->set_state_internal(pre_crit);
-		if (sesame_status) {
-			battery_critical_sensor->publish_state(sesame_status->battery_critical());
-		} else {
-			battery_critical_sensor->invalidate_state();
+		if (critical_filter.test(sesame_status ? sesame_status->battery_critical() : NAN, now)) {
+			if (sesame_status) {
+				battery_critical_sensor->publish_state(sesame_status->battery_critical());
+			} else {
+				battery_critical_sensor->invalidate_state();
+			}
 		}
 	}
+	publish_motion(now);
+}
+
+/**
+ * Publish position and target at most once per `motion_publish_interval` while the motor is running, and once more
+ * when it stops.
+ */
+void
+SesameComponent::publish_motion(uint32_t now) {
+	if (!position_sensor && !target_sensor) {
+		return;
+	}
+	bool moving = sesame_status && sesame_status->motor_status() != Sesame::motor_status_t::idle &&
+	              sesame_status->motor_status() != Sesame::motor_status_t::holding;
+	if (moving && motion_published && now - motion_published < motion_publish_interval) {
+		return;
+	}
+	motion_published = moving ? std::max<uint32_t>(now, 1) : 0;
+	auto publish = [](sensor::Sensor* sensor, float value) {
+		if (sensor && (!sensor->has_state() || (sensor->state != value && !(std::isnan(sensor->state) && std::isnan(value))))) {
+			sensor->publish_state(value);
+		}
+	};
+	publish(position_sensor, sesame_status ? sesame_status->position() : NAN);
+	publish(target_sensor, sesame_status ? sesame_status->target() : NAN);
+}
+
+void
+SesameComponent::set_publish_filter(float pct_threshold, float voltage_threshold, uint32_t max_interval) {
+	pct_filter.configure(pct_threshold, max_interval, &suppressed_publishes);
+	voltage_filter.configure(voltage_threshold, max_interval, &suppressed_publishes);
+	critical_filter.configure(0, max_interval, &suppressed_publishes);
+}
+
+/**
+ * Reflect statuses queued by the NimBLE host task in order, so that no transition is lost.
+ */
+void
+SesameComponent::handle_status_events() {
+	if (auto overflows = status_events.get_overflows(); overflows != reported_status_overflows) {
+		ESP_LOGW(TAG, "%lu status notifications dropped", overflows - reported_status_overflows);
+		reported_status_overflows = overflows;
+	}
+	while (status_events.pop(sesame_status)) {
+		operation_requested.update_status = false;
+		reflect_sesame_status();
+	}
+}
+
+/**
+ * Wake the loop sleeping by test_idle(). May be called from the NimBLE host task.
+ */
+void
+SesameComponent::wake_loop() {
+#if ESPHOME_VERSION_CODE >= VERSION_CODE(2025, 7, 0)
+	enable_loop_soon_any_context();
+#endif
+}
+
+/**
+ * Stop calling loop() while nothing is due, until woken by an event or the "wake" interval set in setup().
+ */
+void
+SesameComponent::test_idle() {
+#if ESPHOME_VERSION_CODE >= VERSION_CODE(2025, 7, 0)
+	bool idle_state = my_state == state_t::running ||
+	                  (my_state == state_t::not_connected && !always_connect && operation_requested.value == 0 &&
+	                   requested_priority == connect_priority_t::background);
+	if (!idle_state || !status_events.empty() || (feature && !feature->is_idle())) {
+		return;
+	}
+	disable_loop();
+#endif
+}
+
+void
+SesameComponent::report_suppressed_publishes(uint32_t now) {
+	if (!suppressed_publishes_sensor || suppressed_publishes == reported_suppressed_publishes ||
+	    now - suppressed_publishes_reported < SUPPRESSED_PUBLISHES_REPORT_INTERVAL) {
+		return;
+	}
+	reported_suppressed_publishes = suppressed_publishes;
+	suppressed_publishes_reported = now;
+	suppressed_publishes_sensor->publish_state(suppressed_publishes);
 }
 
 void
@@ -152,6 +444,13 @@ SesameComponent::set_state(state_t next_state) {
 	if (my_state == state_t::wait_reboot) {
 		return;
 	}
+	if (my_state == state_t::running) {
+		connect_requested = 0;
+	}
+	auto now = esphome::millis();
+	if (phase_latency) {
+		record_phase_latency(my_state, now - state_started);
+	}
 	my_state = next_state;
 	if (my_state == state_t::not_connected) {
 		if (server && server->has_trigger(ble_address)) {
@@ -159,13 +458,55 @@ SesameComponent::set_state(state_t next_state) {
 			ESP_LOGD(TAG, "Advertising restarted");
 		}
 	}
-	state_started = esphome::millis();
+	state_started = now;
+}
+
+static int
+phase_index(state_t state) {
+	switch (state) {
+		case state_t::wait_connect:
+			return 0;
+		case state_t::wait_server_disconnect:
+			return 1;
+		case state_t::wait_radio:
+			return 2;
+		case state_t::connecting:
+			return 3;
+		case state_t::authenticating:
+			return 4;
+		default:
+			return -1;
+	}
+}
+
+void
+SesameComponent::set_phase_latency_sensor(state_t phase, latency_stat_t stat, sensor::Sensor* sensor) {
+	int index = phase_index(phase);
+	if (index < 0) {
+		return;
+	}
+	if (!phase_latency) {
+		phase_latency = std::make_unique<phase_latency_t>();
+	}
+	phase_latency->sensors[index].set_sensor(stat, sensor);
+}
+
+void
+SesameComponent::record_phase_latency(state_t phase, uint32_t elapsed) {
+	int index = phase_index(phase);
+	if (index < 0) {
+		return;
+	}
+	phase_latency->histograms[index].add(elapsed);
+	phase_latency->sensors[index].publish(phase_latency->histograms[index]);
 }
 
 void
 SesameComponent::disconnect() {
 	sesame.disconnect();
-	sesame_status.reset();
+	if (!passive) {
+		sesame_status.reset();
+	}
 	set_state(state_t::not_connected);
 	publish_connection_state(false);
 	ESP_LOGI(TAG, "Disconnected");
@@ -174,6 +515,11 @@ SesameComponent::disconnect() {
 void
 SesameComponent::loop() {
 	auto now = esphome::millis();
+	handle_status_events();
+	if (advertisement_listener) {
+		test_advertisement(now);
+	}
+	report_suppressed_publishes(now);
 	if (feature) {
 		feature->loop();
 	}
@@ -185,17 +531,39 @@ SesameComponent::loop() {
 				set_state(state_t::wait_reboot);
 				break;
 			}
-			if (always_connect || operation_requested.value != 0) {
-				if (!last_connect_attempted || now - last_connect_attempted >= CONNECT_RETRY_INTERVAL) {
+			if (always_connect || operation_requested.value != 0 || requested_priority == connect_priority_t::command) {
+				if (!last_connect_attempted || now - last_connect_attempted >= connect_retry_delay ||
+				    requested_priority == connect_priority_t::command) {
+					// Connecting to a device not advertising would just time out, wait for its advertisement instead
+					if (advertisement_listener && !advertised_within(now, CONNECT_ADVERTISEMENT_AGE)) {
+						if (!waiting_advertisement) {
+							ESP_LOGD(TAG, "No advertisement received recently, connection deferred");
+							waiting_advertisement = true;
+						}
+						break;
+					}
+					if (waiting_advertisement) {
+						ESP_LOGD(TAG, "Advertisement received, connecting");
+						waiting_advertisement = false;
+					}
 					last_connect_attempted = now;
-					enqueue_connect(this);
+					connect_retry_delay = next_retry_delay();
+					if (!connect_requested) {
+						connect_requested = now;
+					}
+					connect_wait_started = now;
+					enqueue_connect(this, connect_priority());
 					set_state(state_t::wait_connect);
 				}
 			}
 			break;
 		case state_t::wait_connect:
 			if (can_connect(this)) {
-				ESP_LOGD(TAG, "My turn to connect");
+				ESP_LOGD(TAG, "My turn to connect (waited %lu ms)", now - connect_wait_started);
+				if (connect_wait_sensor) {
+					connect_wait_sensor->publish_state(now - connect_wait_started);
+				}
+				requested_priority = connect_priority_t::background;
 				if (server && server->has_trigger(ble_address)) {
 					server->stop_advertising();
 					if (server->has_session(ble_address)) {
@@ -204,18 +572,20 @@ SesameComponent::loop() {
 					}
 					set_state(state_t::wait_server_disconnect);
 				} else {
-					++connect_tried;
-					if (sesame.connect_async()) {
-						set_state(state_t::connecting);
-					} else {
-						ESP_LOGW(TAG, "Failed to start connect rc=%d", get_last_error());
-						disconnect();
-						connect_done(this);
-						set_state(state_t::not_connected);
-					}
+					start_connect();
 				}
 			}
 			break;
+		case state_t::wait_radio:
+			if (now - state_started > RADIO_WAIT_TIMEOUT) {
+				ESP_LOGW(TAG, "Other connection not finished, give up connecting");
+				++connect_tried;
+				connect_done(this);
+				set_state(state_t::not_connected);
+				break;
+			}
+			start_connect();
+			break;
 		case state_t::wait_server_disconnect:
 			if (now - state_started > DISCONNECT_WAIT_TIMEOUT) {
 				ESP_LOGW(TAG, "Disconnect from server not finished");
@@ -225,15 +595,7 @@ SesameComponent::loop() {
 			}
 			if (server && !server->has_session(ble_address)) {
 				ESP_LOGD(TAG, "Server disconnected");
-				++connect_tried;
-				if (sesame.connect_async()) {
-					set_state(state_t::connecting);
-				} else {
-					ESP_LOGW(TAG, "Failed to start connect rc=%d", get_last_error());
-					disconnect();
-					connect_done(this);
-					set_state(state_t::not_connected);
-				}
+				start_connect();
 			}
 			break;
 		case state_t::connecting:
@@ -266,15 +628,18 @@ SesameComponent::loop() {
 				connect_done(this);
 				disconnect();
 				make_unknown();
+				on_connect_failed();
 			}
 			break;
 		case state_t::authenticating:
 			if (sesame.get_state() == SesameClient::state_t::active) {
 				connect_tried = 0;
 				last_connect_attempted = 0;
+				reset_backoff();
+				update_cached_address();
 				set_state(state_t::running);
 				publish_connection_state(true);
-				ESP_LOGI(TAG, "Authenticated");
+				ESP_LOGI(TAG, "Authenticated (%lu ms after connect requested)", now - connect_requested);
 			} else if ((sesame.get_state() != SesameClient::state_t::connected &&
 			            sesame.get_state() != SesameClient::state_t::authenticating) ||
 			           now - state_started > AUTHENTICATE_TIMEOUT) {
@@ -298,6 +663,7 @@ SesameComponent::loop() {
 			}
 			break;
 	}
+	test_idle();
 }
 
 void
@@ -307,39 +673,143 @@ SesameComponent::publish_connection_state(bool connected) {
 	}
 }
 
+void
+SesameComponent::start_connect() {
+	if (sesame.connect_async()) {
+		++connect_tried;
+		set_state(state_t::connecting);
+		return;
+	}
+#ifdef BLE_HS_EALREADY
+	if (get_last_error() == BLE_HS_EALREADY) {
+		// Another slot is still establishing its link, keep our slot and retry on the next loop
+		if (my_state != state_t::wait_radio) {
+			ESP_LOGD(TAG, "Connection already in progress, wait for it");
+			set_state(state_t::wait_radio);
+		}
+		return;
+	}
+#endif
+	++connect_tried;
+	ESP_LOGW(TAG, "Failed to start connect rc=%d", get_last_error());
+	disconnect();
+	connect_done(this);
+	set_state(state_t::not_connected);
+}
+
+/**
+ * Delay before the next connection attempt if the one being started now fails.
+ * Doubles from `connect_retry_min_interval` on each consecutive attempt up to `connect_retry_max_interval`, with +-25% jitter
+ * so that devices failing together do not retry in lockstep.
+ */
+uint32_t
+SesameComponent::next_retry_delay() {
+	uint64_t delay = static_cast<uint64_t>(connect_retry_min_interval) << std::min(backoff_level, MAX_BACKOFF_SHIFT);
+	if (delay >= connect_retry_max_interval) {
+		delay = connect_retry_max_interval;
+	} else {
+		++backoff_level;
+		if (connect_backoff_sensor) {
+			connect_backoff_sensor->publish_state(backoff_level);
+		}
+	}
+	uint32_t jittered = delay - delay / 4 + random_uint32() % (delay / 2 + 1);
+	ESP_LOGD(TAG, "Next connection retry after %lu ms (backoff level %u)", jittered, backoff_level);
+	return jittered;
+}
+
+void
+SesameComponent::reset_backoff() {
+	connect_retry_delay = 0;
+	if (backoff_level != 0) {
+		backoff_level = 0;
+		if (connect_backoff_sensor) {
+			connect_backoff_sensor->publish_state(0);
+		}
+	}
+}
+
+connect_priority_t
+SesameComponent::connect_priority() const {
+	if (requested_priority != connect_priority_t::background) {
+		return requested_priority;
+	}
+	if (operation_requested.update_status) {
+		return connect_priority_t::status;
+	}
+	return connect_priority_t::background;
+}
+
+/**
+ * Ask for a connection on behalf of an operation, raising the priority if already waiting.
+ * `command` priority also skips the reconnect interval.
+ */
+void
+SesameComponent::request_connect(connect_priority_t priority) {
+	if (priority > requested_priority) {
+		requested_priority = priority;
+	}
+	wake_loop();
+	if (my_state == state_t::wait_connect) {
+		enqueue_connect(this, connect_priority());
+	}
+}
+
 bool
-SesameComponent::enqueue_connect(SesameComponent* client) {
-	std::lock_guard lock(ble_connecting_mux);
-	connect_queue.push_back(client);
-	return connect_queue.front() == client;
+SesameComponent::enqueue_connect(SesameComponent* client, connect_priority_t priority) {
+	return connect_scheduler.enqueue(client, priority, esphome::millis());
 }
 
 void
 SesameComponent::connect_done(SesameComponent* client) {
-	std::lock_guard lock(ble_connecting_mux);
-	if (client == connect_queue.front()) {
-		connect_queue.erase(std::cbegin(connect_queue));
-		return;
-	}
-	ESP_LOGD(STATIC_TAG, "Connection queue mishandled");
-	(void)std::remove(std::begin(connect_queue), std::end(connect_queue), client);
-	return;
+	connect_scheduler.release(client);
 }
 
 bool
 SesameComponent::can_connect(SesameComponent* client) {
-	std::lock_guard lock(ble_connecting_mux);
-	return client == connect_queue.front();
+	return connect_scheduler.try_admit(client, esphome::millis());
 }
 
-static bool
-is_central_model(Sesame::model_t model) {
-	return model == Sesame::model_t::sesame_touch || model == Sesame::model_t::sesame_touch_pro || model == Sesame::model_t::remote ||
-	       model == Sesame::model_t::remote_nano || model == Sesame::model_t::open_sensor_1;
+/**
+ * Switch to `active_interval` polling after a command or motor movement.
+ */
+void
+SesameComponent::note_activity() {
+	if (!active_interval) {
+		return;
+	}
+	last_activity = std::max<uint32_t>(esphome::millis(), 1);
+	if (get_update_interval() != active_interval) {
+		ESP_LOGD(TAG, "Activity detected, polling every %lu ms", active_interval);
+		apply_update_interval(active_interval);
+	}
+}
+
+/**
+ * After `active_window` without activity, double the interval on each poll back to the configured `update_interval`.
+ */
+void
+SesameComponent::adapt_update_interval(uint32_t now) {
+	auto current = get_update_interval();
+	if (!active_interval || current == idle_interval || (last_activity && now - last_activity < active_window)) {
+		return;
+	}
+	last_activity = 0;
+	apply_update_interval(static_cast<uint32_t>(std::min<uint64_t>(static_cast<uint64_t>(current) * 2, idle_interval)));
+}
+
+void
+SesameComponent::apply_update_interval(uint32_t interval) {
+	set_update_interval(interval);
+	start_poller();
+	if (update_interval_sensor) {
+		update_interval_sensor->publish_state(interval);
+	}
 }
 
 void
 SesameComponent::update() {
+	adapt_update_interval(esphome::millis());
 	if (my_state == state_t::running) {
 		if (!sesame.request_status()) {
 			ESP_LOGW(TAG, "Failed to request status");
@@ -352,6 +822,7 @@ SesameComponent::update() {
 			}
 		}
 		operation_requested.update_status = true;
+		wake_loop();
 	} else {
 		ESP_LOGD(TAG, "Skipping update in state %d", static_cast<int>(my_state));
 	}
@@ -359,6 +830,9 @@ SesameComponent::update() {
 
 void
 SesameComponent::make_unknown() {
+	if (passive && advertised_within(esphome::millis(), advertisement_timeout)) {
+		return;
+	}
 	sesame_status.reset();
 	reflect_sesame_status();
 }
@@ -4,11 +4,17 @@
 #include <esphome/components/binary_sensor/binary_sensor.h>
 #include <esphome/components/sensor/sensor.h>
 #include <esphome/core/component.h>
+#include <esphome/core/preferences.h>
 #include <esphome/core/version.h>
-#include <mutex>
+#include <array>
+#include <atomic>
+#include <memory>
 #include <string_view>
-#include <vector>
+#include "connect_scheduler.h"
+#include "event_ring.h"
 #include "feature.h"
+#include "latency_stats.h"
+#include "publish_filter.h"
 
 namespace esphome {
 
@@ -52,14 +58,17 @@ enum class state_t : int8_t {
 	authenticating,
 	running,
 	wait_reboot,
-	wait_server_disconnect
+	wait_server_disconnect,
+	wait_radio,  // admitted, waiting for another connection being established to finish
 };
 
 class SesameLock;
 class BotFeature;
+class AdvertisementScanner;
 class SesameComponent : public PollingComponent {
 	friend class SesameLock;
 	friend class BotFeature;
+	friend class AdvertisementScanner;
 
  public:
 	SesameComponent(const char* id);
@@ -70,59 +79,162 @@ class SesameComponent : public PollingComponent {
 	          std::string_view uuid);
 	void setup() override;
 	void loop() override;
+	void dump_config() override;
 	void set_battery_pct_sensor(sensor::Sensor* sensor) { pct_sensor = sensor; }
 	void set_battery_voltage_sensor(sensor::Sensor* sensor) { voltage_sensor = sensor; }
 	void set_connection_sensor(binary_sensor::BinarySensor* sensor) { connection_sensor = sensor; }
+	void set_connect_wait_sensor(sensor::Sensor* sensor) { connect_wait_sensor = sensor; }
 	void set_battery_critical_sensor(BinarySensorWithInvalidate* sensor) { battery_critical_sensor = sensor; }
 	void set_connect_retry_limit(uint16_t retry_limit) { connect_limit = retry_limit; }
+	void set_connect_retry_interval(uint32_t min_interval, uint32_t max_interval) {
+		connect_retry_min_interval = min_interval;
+		connect_retry_max_interval = max_interval;
+	}
+	void set_connect_backoff_sensor(sensor::Sensor* sensor) { connect_backoff_sensor = sensor; }
+	void set_phase_latency_sensor(state_t phase, latency_stat_t stat, sensor::Sensor* sensor);
+	void set_publish_filter(float pct_threshold, float voltage_threshold, uint32_t max_interval);
+	void set_suppressed_publishes_sensor(sensor::Sensor* sensor) { suppressed_publishes_sensor = sensor; }
+	void set_adaptive_polling(uint32_t active_interval, uint32_t active_window) {
+		this->active_interval = active_interval;
+		this->active_window = active_window;
+	}
+	void set_update_interval_sensor(sensor::Sensor* sensor) { update_interval_sensor = sensor; }
+	void set_position_sensor(sensor::Sensor* sensor) { position_sensor = sensor; }
+	void set_target_sensor(sensor::Sensor* sensor) { target_sensor = sensor; }
+	void set_motion_publish_interval(uint32_t interval) { motion_publish_interval = interval; }
 	void set_connection_timeout(uint32_t timeout) { connection_timeout = timeout; }
+	void set_connect_slots(uint8_t slots) { connect_scheduler.set_slots(slots); }
 	void set_feature(Feature* feature) { this->feature = feature; }
 	void set_always_connect(bool always) { this->always_connect = always; }
+	void set_passive(bool passive) { this->passive = passive; }
+	void set_advertisement_timeout(uint32_t timeout) { advertisement_timeout = timeout; }
+	void set_memory_budget(uint32_t budget) { memory_budget = budget; }
 	virtual float get_setup_priority() const override { return setup_priority::AFTER_WIFI; };
 	void set_sesame_server(sesame_server::SesameServerComponent* server) { this->server = server; }
 	virtual void update() override;
 	void make_unknown();
+	void request_connect(connect_priority_t priority);
 
  private:
 	libsesame3bt::SesameClient sesame;
 	esphome::optional<libsesame3bt::SesameClient::Status> sesame_status;
+	EventRing<decltype(sesame_status), 8> status_events;
+	uint32_t reported_status_overflows = 0;
 	NimBLEAddress ble_address;
+	// Keep the UUID and keys (string literals from generated code) to re-begin with the cached address
+	std::string_view uuid_str;
+	std::string_view pubkey;
+	std::string_view secret;
+	std::array<uint8_t, 16> uuid_bin{};
+	libsesame3bt::Sesame::model_t model = libsesame3bt::Sesame::model_t::unknown;
+	ESPPreferenceObject address_pref;
+	uint64_t cached_address = 0;
+	bool using_cached_address = false;
 	uint32_t last_connect_attempted = 0;
+	uint32_t connect_retry_delay = 0;
+	uint32_t connect_retry_min_interval = 3'000;
+	uint32_t connect_retry_max_interval = 60'000;
 	uint32_t state_started = 0;
-	std::string log_tag_string;
+	uint32_t connect_requested = 0;
+	uint32_t connect_wait_started = 0;
 	const char* TAG = "";
 	sensor::Sensor* pct_sensor = nullptr;
 	sensor::Sensor* voltage_sensor = nullptr;
 	BinarySensorWithInvalidate* battery_critical_sensor = nullptr;
 	Feature* feature = nullptr;
 	binary_sensor::BinarySensor* connection_sensor = nullptr;
+	sensor::Sensor* connect_wait_sensor = nullptr;
+	sensor::Sensor* connect_backoff_sensor = nullptr;
+	sensor::Sensor* suppressed_publishes_sensor = nullptr;
+	sensor::Sensor* update_interval_sensor = nullptr;
+	sensor::Sensor* position_sensor = nullptr;
+	sensor::Sensor* target_sensor = nullptr;
+	uint32_t motion_publish_interval = 500;
+	uint32_t motion_published = 0;
+	uint32_t idle_interval = 0;
+	uint32_t active_interval = 0;
+	uint32_t active_window = 0;
+	uint32_t last_activity = 0;
+	publish_filter pct_filter;
+	publish_filter voltage_filter;
+	publish_filter critical_filter;
+	uint32_t suppressed_publishes = 0;
+	uint32_t reported_suppressed_publishes = 0;
+	uint32_t suppressed_publishes_reported = 0;
 	sesame_server::SesameServerComponent* server = nullptr;
 	state_t my_state = state_t::not_connected;
 	uint16_t connect_limit = 0;
 	uint16_t connect_tried = 0;
+	uint8_t backoff_level = 0;
 	uint32_t connection_timeout = 10'000;
+	uint32_t advertisement_timeout = 60'000;
+	uint32_t memory_budget = 0;
+	std::atomic<uint32_t> advertisement_seen{0};
+	std::atomic<uint8_t> advertisement_flags{0};
+	uint8_t reported_advertisement_flags = 0;
 	bool always_connect = true;
+	bool passive = false;
+	bool advertisement_listener = false;
+	bool waiting_advertisement = false;
+	connect_priority_t requested_priority = connect_priority_t::background;
 	union {
 		uint8_t value;
 		struct {
 			bool update_status : 1;
+			bool command : 1;
 		};
 	} operation_requested{};
 	static_assert(sizeof(operation_requested.value) == sizeof(operation_requested));
+	struct phase_latency_t {
+		static constexpr size_t NUM_PHASES = 5;
+		std::array<latency_histogram, NUM_PHASES> histograms;
+		std::array<latency_sensors, NUM_PHASES> sensors;
+	};
+	std::unique_ptr<phase_latency_t> phase_latency;
 
 	static inline int instance_count = 0;
-	static inline std::mutex ble_connecting_mux{};
-	static inline std::vector<SesameComponent*> connect_queue{};
+	static inline ConnectScheduler connect_scheduler{};
 	static inline bool global_initialized{};
 
 	void set_state(state_t);
+	void record_phase_latency(state_t phase, uint32_t elapsed);
 	void reflect_sesame_status();
+	void publish_motion(uint32_t now);
+	size_t heap_usage() const;
+	size_t memory_usage() const;
+	void test_memory_budget();
 	void publish_connection_state(bool connected);
 	void disconnect();
+	void start_connect();
+	void set_command_in_progress(bool in_progress) {
+		operation_requested.command = in_progress;
+		if (in_progress) {
+			note_activity();
+		}
+	}
+	void note_activity();
+	void adapt_update_interval(uint32_t now);
+	void apply_update_interval(uint32_t interval);
+	bool is_advertisement_of(uint64_t address, const uint8_t* uuid) const;
+	void handle_advertisement(uint8_t flags);
+	bool advertised_within(uint32_t now, uint32_t age) const;
+	void test_advertisement(uint32_t now);
+	void report_suppressed_publishes(uint32_t now);
+	void handle_status_events();
+	void wake_loop();
+	void test_idle();
+	bool begin_client(const NimBLEAddress* address);
+	void load_cached_address();
+	void update_cached_address();
+	void fallback_to_uuid();
+	void on_connect_failed();
+	connect_priority_t connect_priority() const;
+	uint32_t next_retry_delay();
+	void reset_backoff();
 	int get_last_error() const { return sesame.get_ble_client() ? sesame.get_ble_client()->getLastError() : -1; }
 
 	static void global_init();
-	static bool enqueue_connect(SesameComponent*);
+	static bool enqueue_connect(SesameComponent*, connect_priority_t);
 	static bool can_connect(SesameComponent*);
 	static void connect_done(SesameComponent*);
 };
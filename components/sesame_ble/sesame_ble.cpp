@@ -1,7 +1,8 @@
 #include "sesame_ble.h"
 #include <libsesame3bt/ScannerCore.h>
 #include <algorithm>
-#include <unordered_map>
+#include <array>
+#include "esphome/core/hal.h"
 #include "esphome/core/log.h"
 
 namespace esphome {
@@ -69,14 +70,63 @@ model_str(Sesame::model_t model) {
 	}
 }
 
-static std::unordered_map<std::string, uint32_t> uniq_addrs;
+constexpr uint32_t REPORT_INTERVAL = 10'000;
+constexpr size_t MAX_MANUFACTURER_DATA_SIZE = 31;
+
+/**
+ * Fixed-size open-addressed table of recently reported addresses.
+ * Only SESAME devices are inserted; when no free slot is found within the probe window, the oldest entry is evicted.
+ */
+class SeenTable {
+ public:
+	bool recently_seen(uint64_t addr, uint32_t now) const {
+		for (size_t i = 0; i < MAX_PROBE; i++) {
+			const auto& e = entries[slot(addr, i)];
+			if (e.addr == addr) {
+				return now - e.last < REPORT_INTERVAL;
+			}
+		}
+		return false;
+	}
+	void mark(uint64_t addr, uint32_t now) {
+		entry_t* victim = nullptr;
+		for (size_t i = 0; i < MAX_PROBE; i++) {
+			auto& e = entries[slot(addr, i)];
+			if (e.addr == addr) {
+				e.last = now;
+				return;
+			}
+			if (!victim || e.addr == 0 || (victim->addr != 0 && now - e.last > now - victim->last)) {
+				victim = &e;
+			}
+		}
+		victim->addr = addr;
+		victim->last = now;
+	}
+
+ private:
+	static constexpr size_t SIZE = 64;
+	static constexpr size_t MAX_PROBE = 8;
+	struct entry_t {
+		uint64_t addr;
+		uint32_t last;
+	};
+	std::array<entry_t, SIZE> entries{};
+
+	static size_t slot(uint64_t addr, size_t probe) {
+		return (static_cast<size_t>((addr * 0x9e3779b97f4a7c15ULL) >> 58) + probe) % SIZE;
+	}
+};
+
+static SeenTable seen_addrs;
 static const ESPBTUUID SESAME_SRV_UUID = ESPBTUUID::from_raw(Sesame::SESAME3_SRV_UUID);
 
 }  // namespace
 
 bool
 esphome::sesame_ble::SesameBleListener::parse_device(const esp32_ble_tracker::ESPBTDevice& device) {
-	if (auto last = uniq_addrs[device.address_str()]; last && esphome::millis() - last < 10'000) {
+	auto addr = device.address_uint64();
+	if (seen_addrs.recently_seen(addr, esphome::millis())) {
 		return false;
 	}
 	if (const auto& services = device.get_service_uuids();
@@ -91,17 +141,19 @@ esphome::sesame_ble::SesameBleListener::parse_device(const esp32_ble_tracker::ES
 			break;
 		}
 	}
-	if (!found) {
+	if (!found || found->data.size() > MAX_MANUFACTURER_DATA_SIZE) {
 		return false;
 	}
-	auto manu_data = std::string{0x5a, 0x05} + std::string(reinterpret_cast<const char*>(found->data.data()), found->data.size());
+	std::array<char, 2 + MAX_MANUFACTURER_DATA_SIZE> manu_buf{0x5a, 0x05};
+	std::copy(std::cbegin(found->data), std::cend(found->data), std::begin(manu_buf) + 2);
+	std::string_view manu_data{manu_buf.data(), 2 + found->data.size()};
 	uint8_t uuid_bin[16];
 	auto [model, flag_byte, is_valid] = libsesame3bt::core::parse_advertisement(manu_data, device.get_name(), uuid_bin);
 	if (is_valid) {
 		std::reverse(std::begin(uuid_bin), std::end(uuid_bin));
 		auto uuid = ESPBTUUID::from_raw(uuid_bin);
 		ESP_LOGI(TAG, "%s SESAME %s UUID=%s", device.address_str().c_str(), model_str(model), uuid.to_string().c_str());
-		uniq_addrs[device.address_str()] = esphome::millis();
+		seen_addrs.mark(addr, esphome::millis());
 	}
 
 	return is_valid;
@@ -0,0 +1,52 @@
+import esphome.codegen as cg
+from esphome.components import lock, sensor, text_sensor
+import esphome.config_validation as cv
+from esphome.const import (
+    CONF_ID,
+    CONF_STATE,
+    CONF_TIMEOUT,
+    DEVICE_CLASS_DURATION,
+    STATE_CLASS_MEASUREMENT,
+    UNIT_MILLISECOND,
+)
+
+DEPENDENCIES = ["sesame"]
+AUTO_LOAD = ["sensor", "text_sensor"]
+
+CONF_LOCKS = "locks"
+CONF_COMPLETION_TIME = "completion_time"
+
+sesame_lock_ns = cg.esphome_ns.namespace("sesame_lock")
+SesameLock = sesame_lock_ns.class_("SesameLock", lock.Lock)
+sesame_group_ns = cg.esphome_ns.namespace("sesame_group")
+SesameGroup = sesame_group_ns.class_("SesameGroup", cg.Component)
+
+CONFIG_SCHEMA = cv.Schema(
+    {
+        cv.GenerateID(): cv.declare_id(SesameGroup),
+        cv.Required(CONF_LOCKS): cv.All(cv.ensure_list(cv.use_id(SesameLock)), cv.Length(min=1)),
+        cv.Optional(CONF_STATE): text_sensor.text_sensor_schema(),
+        cv.Optional(CONF_COMPLETION_TIME): sensor.sensor_schema(
+            unit_of_measurement=UNIT_MILLISECOND,
+            device_class=DEVICE_CLASS_DURATION,
+            state_class=STATE_CLASS_MEASUREMENT,
+            accuracy_decimals=0,
+        ),
+        cv.Optional(CONF_TIMEOUT, default="60s"): cv.positive_time_period_milliseconds,
+    }
+).extend(cv.COMPONENT_SCHEMA)
+
+
+async def to_code(config):
+    var = cg.new_Pvariable(config[CONF_ID])
+    await cg.register_component(var, config)
+    for lock_id in config[CONF_LOCKS]:
+        lck = await cg.get_variable(lock_id)
+        cg.add(var.add_lock(lck))
+    if CONF_STATE in config:
+        s = await text_sensor.new_text_sensor(config[CONF_STATE])
+        cg.add(var.set_state_sensor(s))
+    if CONF_COMPLETION_TIME in config:
+        s = await sensor.new_sensor(config[CONF_COMPLETION_TIME])
+        cg.add(var.set_completion_time_sensor(s))
+    cg.add(var.set_operation_timeout(config[CONF_TIMEOUT].total_milliseconds))
@@ -0,0 +1,134 @@
+#include "sesame_group.h"
+#include <esphome/core/hal.h>
+#include <esphome/core/log.h>
+#include <algorithm>
+
+namespace {
+
+constexpr const char* TAG = "sesame_group";
+constexpr const char* OPERATION_TIMER = "operation";
+
+}  // namespace
+
+namespace esphome {
+namespace sesame_group {
+
+using lock::LockState;
+
+void
+SesameGroup::setup() {
+	for (auto& m : members) {
+		m.lock->add_on_state_callback([this, &m](auto&&...) { on_lock_state_changed(m); });
+	}
+	publish_group_state();
+}
+
+void
+SesameGroup::dump_config() {
+	ESP_LOGCONFIG(TAG, "SESAME Group: %u locks", static_cast<unsigned>(members.size()));
+	LOG_TEXT_SENSOR("  ", "State", state_sensor);
+	LOG_SENSOR("  ", "Completion time", completion_time_sensor);
+}
+
+/**
+ * Issue the command to every member at once. Connected members send it immediately, the others queue it and request a
+ * connection with command priority, so they connect in parallel as far as connect_slots allows.
+ */
+void
+SesameGroup::operate_all(LockState target) {
+	if (operation_started) {
+		ESP_LOGD(TAG, "Previous %s operation superseded", LOG_STR_ARG(lock::lock_state_to_string(operation_target)));
+	}
+	operation_target = target;
+	operation_started = std::max<uint32_t>(millis(), 1);
+	ESP_LOGI(TAG, "%s %u locks", target == lock::LOCK_STATE_LOCKED ? "Locking" : "Unlocking", static_cast<unsigned>(members.size()));
+	for (auto& m : members) {
+		m.sent_commands = m.lock->get_sent_commands();
+		m.pending = true;
+	}
+	set_timeout(OPERATION_TIMER, operation_timeout, [this]() { finish_operation(true); });
+	for (auto& m : members) {
+		m.lock->make_call().set_state(target).perform();
+	}
+	publish_group_state();
+}
+
+void
+SesameGroup::finish_operation(bool timed_out) {
+	auto elapsed = millis() - operation_started;
+	auto reached =
+	    std::count_if(std::cbegin(members), std::cend(members), [this](const auto& m) { return m.lock->state == operation_target; });
+	if (timed_out) {
+		ESP_LOGW(TAG, "%u of %u locks did not reach %s in %lu ms", static_cast<unsigned>(members.size() - reached),
+		         static_cast<unsigned>(members.size()), LOG_STR_ARG(lock::lock_state_to_string(operation_target)), elapsed);
+	} else {
+		cancel_timeout(OPERATION_TIMER);
+		ESP_LOGI(TAG, "Operation finished in %lu ms (%u/%u reached %s)", elapsed, static_cast<unsigned>(reached),
+		         static_cast<unsigned>(members.size()), LOG_STR_ARG(lock::lock_state_to_string(operation_target)));
+	}
+	operation_started = 0;
+	for (auto& m : members) {
+		m.pending = false;
+	}
+	if (completion_time_sensor) {
+		completion_time_sensor->publish_state(timed_out ? NAN : elapsed);
+	}
+}
+
+/**
+ * A member is done when it reports the target (or jammed) after its command was sent; a state it already had when the
+ * operation started does not count.
+ */
+void
+SesameGroup::on_lock_state_changed(member_t& member) {
+	if (member.pending && member.lock->get_sent_commands() != member.sent_commands &&
+	    (member.lock->state == operation_target || member.lock->state == lock::LOCK_STATE_JAMMED)) {
+		member.pending = false;
+		if (std::none_of(std::cbegin(members), std::cend(members), [](const auto& m) { return m.pending; })) {
+			finish_operation(false);
+		}
+	}
+	publish_group_state();
+}
+
+void
+SesameGroup::publish_group_state() {
+	auto st = aggregate_state();
+	if (st == group_state) {
+		return;
+	}
+	group_state = st;
+	ESP_LOGD(TAG, "State %s", st);
+	if (state_sensor) {
+		state_sensor->publish_state(st);
+	}
+}
+
+const char*
+SesameGroup::aggregate_state() const {
+	auto any = [this](LockState s) {
+		return std::any_of(std::cbegin(members), std::cend(members), [s](const auto& m) { return m.lock->state == s; });
+	};
+	if (members.empty()) {
+		return "unknown";
+	}
+	if (any(lock::LOCK_STATE_JAMMED)) {
+		return "jammed";
+	}
+	if (any(lock::LOCK_STATE_LOCKING) || any(lock::LOCK_STATE_UNLOCKING)) {
+		return "moving";
+	}
+	if (any(lock::LOCK_STATE_NONE)) {
+		return "unknown";
+	}
+	if (!any(lock::LOCK_STATE_UNLOCKED)) {
+		return "locked";
+	}
+	if (!any(lock::LOCK_STATE_LOCKED)) {
+		return "unlocked";
+	}
+	return "partial";
+}
+
+}  // namespace sesame_group
+}  // namespace esphome
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <esphome/components/lock/lock.h>
+#include <esphome/components/sensor/sensor.h>
+#include <esphome/components/text_sensor/text_sensor.h>
+#include <esphome/core/component.h>
+#include <vector>
+#include "../sesame/lock_feature.h"
+
+namespace esphome {
+namespace sesame_group {
+
+class SesameGroup : public Component {
+ public:
+	void setup() override;
+	void dump_config() override;
+	float get_setup_priority() const override { return setup_priority::DATA; }
+	void add_lock(sesame_lock::SesameLock* lock) { members.push_back({lock}); }
+	void set_state_sensor(text_sensor::TextSensor* sensor) { state_sensor = sensor; }
+	void set_completion_time_sensor(sensor::Sensor* sensor) { completion_time_sensor = sensor; }
+	void set_operation_timeout(uint32_t timeout) { operation_timeout = timeout; }
+	void lock_all() { operate_all(lock::LOCK_STATE_LOCKED); }
+	void unlock_all() { operate_all(lock::LOCK_STATE_UNLOCKED); }
+
+ private:
+	struct member_t {
+		sesame_lock::SesameLock* lock;
+		uint16_t sent_commands = 0;  // of the lock when the operation started
+		bool pending = false;        // waiting for the state reported after the command was sent
+	};
+	std::vector<member_t> members;
+	text_sensor::TextSensor* state_sensor = nullptr;
+	sensor::Sensor* completion_time_sensor = nullptr;
+	uint32_t operation_timeout = 60'000;
+	uint32_t operation_started = 0;
+	lock::LockState operation_target = lock::LOCK_STATE_NONE;
+	const char* group_state = nullptr;
+
+	void operate_all(lock::LockState target);
+	void finish_operation(bool timed_out);
+	void on_lock_state_changed(member_t& member);
+	void publish_group_state();
+	const char* aggregate_state() const;
+};
+
+}  // namespace sesame_group
+}  // namespace esphome
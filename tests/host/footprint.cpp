@@ -0,0 +1,62 @@
+#include <sesame/bot_feature.h>
+#include <sesame/lock_feature.h>
+#include <sesame/sesame_component.h>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+
+/**
+ * Memory held by one SESAME in typical configurations, as logged by dump_config() on the device.
+ * Sizes are of the host build (64-bit pointers, fake SesameClient), so they differ from ESP32; use them to compare changes.
+ * Exits with failure if the lock without history exceeds the budget given as the first argument.
+ */
+
+using esphome::sesame_lock::BotFeature;
+using esphome::sesame_lock::Feature;
+using esphome::sesame_lock::SesameComponent;
+using esphome::sesame_lock::SesameLock;
+using libsesame3bt::Sesame;
+
+namespace {
+
+size_t
+report(const char* name, const Feature& feature) {
+	size_t component = sizeof(SesameComponent) - sizeof(libsesame3bt::SesameClient);
+	size_t client = sizeof(libsesame3bt::SesameClient);
+	size_t total = component + client + feature.object_size() + feature.heap_usage();
+	std::printf("%-20s component=%zu client=%zu feature=%zu heap=%zu total=%zu\n", name, component, client, feature.object_size(),
+	            feature.heap_usage(), total);
+	return total;
+}
+
+}  // namespace
+
+int
+main(int argc, char** argv) {
+	size_t budget = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 0;
+
+	SesameComponent c1{"lock"};
+	SesameLock lock{&c1, Sesame::model_t::sesame_5, "esphome"};
+	lock.init();
+	auto lock_total = report("lock", lock);
+
+	esphome::text_sensor::TextSensor tag, event;
+	esphome::sensor::Sensor type;
+	SesameComponent c2{"lock_history"};
+	SesameLock history_lock{&c2, Sesame::model_t::sesame_5, "esphome"};
+	history_lock.set_history_tag_sensor(&tag);
+	history_lock.set_history_type_sensor(&type);
+	history_lock.set_all_history_event_sensor(&event);
+	history_lock.init();
+	report("lock with history", history_lock);
+
+	SesameComponent c3{"bot"};
+	BotFeature bot{&c3, Sesame::model_t::sesame_bot_2};
+	report("bot", bot);
+
+	if (budget && lock_total > budget) {
+		std::printf("lock uses %zu bytes, over the budget of %zu bytes\n", lock_total, budget);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,367 @@
+#include "host.h"
+#include <NimBLEDevice.h>
+#include <esphome/components/lock/lock.h>
+#include <esphome/core/application.h>
+#include <esphome/core/log.h>
+#include <esphome/core/preferences.h>
+#include <libsesame3bt/ScannerCore.h>
+#include <libsesame3bt/util.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct scheduled_t {
+	esphome::Component* component;
+	std::string name;
+	uint32_t due;
+	uint32_t interval;
+	std::function<void()> func;
+	bool repeat;
+	uint64_t seq;
+};
+
+uint32_t clock_ms = 1'000;
+uint64_t next_seq = 0;
+std::vector<scheduled_t> scheduled;
+std::map<const esphome::Component*, uint64_t> loops;
+std::map<const esphome::Component*, uint64_t> schedules;
+std::map<const esphome::Component*, host::loop_cost_t> costs;
+std::atomic<uint64_t> allocation_count{0};
+uint64_t log_counts[128];
+int tests_run = 0;
+int tests_failed = 0;
+bool current_failed = false;
+
+bool
+is_due(const scheduled_t& item, uint32_t now) {
+	return static_cast<int32_t>(now - item.due) >= 0;
+}
+
+void
+run_scheduled() {
+	for (;;) {
+		auto it = std::min_element(scheduled.begin(), scheduled.end(), [](const auto& a, const auto& b) {
+			auto da = static_cast<int32_t>(a.due - clock_ms), db = static_cast<int32_t>(b.due - clock_ms);
+			return da != db ? da < db : a.seq < b.seq;
+		});
+		if (it == scheduled.end() || !is_due(*it, clock_ms)) {
+			return;
+		}
+		auto item = std::move(*it);
+		scheduled.erase(it);
+		if (item.repeat) {
+			scheduled.push_back({item.component, item.name, clock_ms + item.interval, item.interval, item.func, true, next_seq++});
+		}
+		item.func();
+	}
+}
+
+}  // namespace
+
+void*
+operator new(size_t size) {
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+	if (void* p = std::malloc(size ? size : 1)) {
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+void
+operator delete(void* p) noexcept {
+	std::free(p);
+}
+
+void
+operator delete(void* p, size_t) noexcept {
+	std::free(p);
+}
+
+namespace esphome {
+
+Application App;
+ESPPreferences* global_preferences = new ESPPreferences();
+
+uint32_t
+millis() {
+	return clock_ms;
+}
+
+uint32_t
+micros() {
+	return clock_ms * 1000;
+}
+
+uint32_t
+random_uint32() {
+	static uint32_t x = 2463534242u;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return x;
+}
+
+uint32_t
+fnv1_hash(const std::string& str) {
+	uint32_t hash = 2166136261UL;
+	for (char c : str) {
+		hash *= 16777619UL;
+		hash ^= static_cast<uint8_t>(c);
+	}
+	return hash;
+}
+
+void
+host_log(char level, const char* tag, const char* format, ...) {
+	++log_counts[level & 0x7f];
+	static bool enabled = std::getenv("SESAME_HOST_LOG") != nullptr;
+	if (!enabled) {
+		return;
+	}
+	std::printf("[%6lu][%c][%s] ", static_cast<unsigned long>(clock_ms), level, tag);
+	va_list args;
+	va_start(args, format);
+	std::vprintf(format, args);
+	va_end(args);
+	std::printf("\n");
+}
+
+namespace host {
+
+void
+schedule(Component* component, const std::string& name, uint32_t delay, std::function<void()>&& func, bool repeat) {
+	++schedules[component];
+	if (!name.empty()) {
+		cancel(component, name);
+	}
+	scheduled.push_back({component, name, clock_ms + delay, delay, std::move(func), repeat, next_seq++});
+}
+
+bool
+cancel(Component* component, const std::string& name) {
+	auto size = scheduled.size();
+	scheduled.erase(std::remove_if(scheduled.begin(), scheduled.end(),
+	                               [&](const auto& item) { return item.component == component && item.name == name; }),
+	                scheduled.end());
+	return scheduled.size() != size;
+}
+
+}  // namespace host
+
+namespace lock {
+
+const char*
+lock_state_to_string(LockState state) {
+	switch (state) {
+		case LOCK_STATE_LOCKED:
+			return "LOCKED";
+		case LOCK_STATE_UNLOCKED:
+			return "UNLOCKED";
+		case LOCK_STATE_JAMMED:
+			return "JAMMED";
+		case LOCK_STATE_LOCKING:
+			return "LOCKING";
+		case LOCK_STATE_UNLOCKING:
+			return "UNLOCKING";
+		default:
+			return "NONE";
+	}
+}
+
+}  // namespace lock
+}  // namespace esphome
+
+namespace libsesame3bt::core {
+
+/**
+ * Fake advertisement: model, flag byte and 16 bytes of UUID.
+ */
+adv_result
+parse_advertisement(std::string_view manu_data, std::string_view name, uint8_t* uuid) {
+	if (manu_data.size() < 18) {
+		return {Sesame::model_t::unknown, std::byte{0}, false};
+	}
+	std::memcpy(uuid, manu_data.data() + 2, 16);
+	return {static_cast<Sesame::model_t>(manu_data[0]), static_cast<std::byte>(manu_data[1]), true};
+}
+
+namespace util {
+
+std::string
+bin2hex(const char* data, size_t len) {
+	static constexpr char digits[] = "0123456789abcdef";
+	std::string out;
+	for (size_t i = 0; i < len; i++) {
+		out += digits[static_cast<uint8_t>(data[i]) >> 4];
+		out += digits[static_cast<uint8_t>(data[i]) & 0x0f];
+	}
+	return out;
+}
+
+}  // namespace util
+}  // namespace libsesame3bt::core
+
+namespace host {
+
+uint32_t
+now() {
+	return clock_ms;
+}
+
+void
+reset_clock(uint32_t start) {
+	clock_ms = start;
+	scheduled.clear();
+}
+
+void
+advance(uint32_t ms) {
+	auto end = clock_ms + ms;
+	// Step through due times so that items run at their own time
+	while (clock_ms != end) {
+		uint32_t next = end;
+		for (const auto& item : scheduled) {
+			if (static_cast<int32_t>(item.due - clock_ms) > 0 && static_cast<int32_t>(item.due - next) < 0) {
+				next = item.due;
+			}
+		}
+		run_scheduled();
+		clock_ms = next;
+	}
+	run_scheduled();
+}
+
+void
+setup(std::initializer_list<esphome::Component*> components) {
+	std::vector<esphome::Component*> sorted(components);
+	std::stable_sort(sorted.begin(), sorted.end(),
+	                 [](auto* a, auto* b) { return a->get_setup_priority() > b->get_setup_priority(); });
+	for (auto* c : sorted) {
+		c->setup();
+		if (auto* polling = dynamic_cast<esphome::PollingComponent*>(c)) {
+			polling->start_poller();
+		}
+	}
+}
+
+void
+tick(std::initializer_list<esphome::Component*> components, uint32_t step) {
+	advance(step);
+	for (auto* c : components) {
+		if (c->is_loop_enabled() && !c->is_failed()) {
+			++loops[c];
+			auto start = std::chrono::steady_clock::now();
+			c->loop();
+			uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+			auto& cost = costs[c];
+			cost.total_ns += ns;
+			cost.max_ns = std::max(cost.max_ns, ns);
+		}
+	}
+}
+
+void
+run(std::initializer_list<esphome::Component*> components, uint32_t duration, uint32_t step) {
+	for (uint32_t elapsed = 0; elapsed < duration; elapsed += step) {
+		tick(components, step);
+	}
+}
+
+uint32_t
+run_until(std::initializer_list<esphome::Component*> components,
+          const std::function<bool()>& done,
+          uint32_t limit,
+          uint32_t step) {
+	uint32_t elapsed = 0;
+	while (!done() && elapsed < limit) {
+		tick(components, step);
+		elapsed += step;
+	}
+	return elapsed;
+}
+
+uint64_t
+loop_calls(const esphome::Component* component) {
+	return loops[component];
+}
+
+const loop_cost_t&
+loop_cost(const esphome::Component* component) {
+	return costs[component];
+}
+
+uint64_t
+schedule_calls(const esphome::Component* component) {
+	return schedules[component];
+}
+
+uint64_t
+allocations() {
+	return allocation_count.load(std::memory_order_relaxed);
+}
+
+uint64_t
+log_count(char level) {
+	return log_counts[level & 0x7f];
+}
+
+void
+advertise(const std::string& address, const std::array<uint8_t, 16>& uuid, uint8_t flags) {
+	auto* scan = NimBLEDevice::getScan();
+	if (!scan->scanning || !scan->callbacks) {
+		return;
+	}
+	NimBLEAdvertisedDevice device;
+	device.address = NimBLEAddress{address, BLE_ADDR_RANDOM};
+	device.manufacturer_data.push_back(static_cast<char>(libsesame3bt::Sesame::model_t::sesame_5));
+	device.manufacturer_data.push_back(static_cast<char>(flags));
+	device.manufacturer_data.append(reinterpret_cast<const char*>(uuid.data()), uuid.size());
+	scan->callbacks->onResult(&device);
+}
+
+void
+test(const char* name, const std::function<void()>& body) {
+	++tests_run;
+	std::fflush(stdout);
+	pid_t pid = fork();
+	if (pid == 0) {
+		body();
+		std::fflush(stdout);
+		_exit(current_failed ? 1 : 0);
+	}
+	int status = 0;
+	waitpid(pid, &status, 0);
+	bool ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+	if (!ok) {
+		++tests_failed;
+	}
+	std::printf("%s %s\n", ok ? "PASS" : "FAIL", name);
+}
+
+bool
+check(bool ok, const char* expr, const char* file, int line) {
+	if (!ok) {
+		current_failed = true;
+		std::printf("  %s:%d: CHECK(%s) failed\n", file, line, expr);
+	}
+	return ok;
+}
+
+int
+finish() {
+	std::printf("%d/%d tests passed\n", tests_run - tests_failed, tests_run);
+	return tests_failed ? 1 : 0;
+}
+
+}  // namespace host
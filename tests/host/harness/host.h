@@ -0,0 +1,53 @@
+#pragma once
+#include <esphome/core/component.h>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <string>
+
+/**
+ * Host-native harness: virtual clock, ESPHome-like scheduler and loop driver.
+ */
+namespace host {
+
+uint32_t now();
+// Restart the virtual clock (and drop scheduled items) at `start`
+void reset_clock(uint32_t start = 1'000);
+// Advance the virtual clock, running scheduled timeouts / intervals that became due
+void advance(uint32_t ms);
+// Call setup() in ESPHome order and start the pollers
+void setup(std::initializer_list<esphome::Component*> components);
+// Run the main loop for `duration` ms of virtual time, one loop() per enabled component every `step` ms
+void run(std::initializer_list<esphome::Component*> components, uint32_t duration, uint32_t step = 16);
+// Run like run() until `done` returns true, for at most `limit` ms. Returns the virtual time taken (`limit` if not done).
+uint32_t run_until(std::initializer_list<esphome::Component*> components,
+                   const std::function<bool()>& done,
+                   uint32_t limit,
+                   uint32_t step = 16);
+// Number of loop() calls made by run()
+uint64_t loop_calls(const esphome::Component* component);
+// Wall-clock time spent in the loop() calls made by run(), in total and by the slowest call
+struct loop_cost_t {
+	uint64_t total_ns = 0;
+	uint64_t max_ns = 0;
+};
+const loop_cost_t& loop_cost(const esphome::Component* component);
+// Number of timeouts, intervals and defers scheduled by `component`
+uint64_t schedule_calls(const esphome::Component* component);
+// Number of operator new calls so far in this process
+uint64_t allocations();
+// Number of log lines written so far with `level` ('E', 'W', 'I', 'D', ...)
+uint64_t log_count(char level);
+// Deliver a SESAME advertisement from `address` to the running scan
+void advertise(const std::string& address, const std::array<uint8_t, 16>& uuid = {}, uint8_t flags = 0);
+
+// Run `body` in a child process so that static state of the components does not leak between tests
+void test(const char* name, const std::function<void()>& body);
+bool check(bool ok, const char* expr, const char* file, int line);
+// Summary and exit code of the test program
+int finish();
+
+}  // namespace host
+
+#define CHECK(cond) host::check(static_cast<bool>(cond), #cond, __FILE__, __LINE__)
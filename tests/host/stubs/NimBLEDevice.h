@@ -0,0 +1,93 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#define BLE_ADDR_RANDOM 1
+#define BLE_HS_EALREADY 2
+#define CONFIG_BT_NIMBLE_MAX_CONNECTIONS 3
+
+struct NimBLEAddress {
+	NimBLEAddress() {}
+	NimBLEAddress(const std::string& str, uint8_t type) : value(str.empty() ? 0 : std::hash<std::string>{}(str)) {}
+	NimBLEAddress(uint64_t value, uint8_t type) : value(value) {}
+	operator uint64_t() const { return value; }
+	uint8_t getType() const { return BLE_ADDR_RANDOM; }
+	bool isNull() const { return value == 0; }
+	bool operator==(const NimBLEAddress& other) const { return value == other.value; }
+	std::string toString() const { return std::to_string(value); }
+	uint64_t value = 0;
+};
+
+struct NimBLEUUID {
+	NimBLEUUID() {}
+	NimBLEUUID(const std::string& str) : str(str) {}
+	bool operator==(const NimBLEUUID& other) const { return str == other.str; }
+	std::string toString() const { return str; }
+	std::string str;
+};
+
+struct NimBLEClient {
+	int last_error = 0;
+	NimBLEAddress peer_address;
+	int getLastError() const { return last_error; }
+	NimBLEAddress getPeerAddress() const { return peer_address; }
+};
+
+struct NimBLEAdvertisedDevice {
+	NimBLEAddress address;
+	std::string manufacturer_data;
+	std::string name;
+	NimBLEAddress getAddress() const { return address; }
+	std::string getManufacturerData(uint8_t index = 0) const { return manufacturer_data; }
+	std::string getName() const { return name; }
+	bool isAdvertisingService(const NimBLEUUID&) const { return true; }
+	int getRSSI() const { return 0; }
+};
+
+struct NimBLEScanResults {};
+
+struct NimBLEScanCallbacks {
+	virtual void onResult(const NimBLEAdvertisedDevice* device) {}
+	virtual void onScanEnd(const NimBLEScanResults& results, int reason) {}
+	virtual ~NimBLEScanCallbacks() {}
+};
+
+struct NimBLEScan {
+	NimBLEScanCallbacks* callbacks = nullptr;
+	bool scanning = false;
+	int start_count = 0;
+	void setScanCallbacks(NimBLEScanCallbacks* callbacks, bool want_duplicates = false) { this->callbacks = callbacks; }
+	void setActiveScan(bool) {}
+	void setInterval(uint16_t) {}
+	void setWindow(uint16_t) {}
+	void setDuplicateFilter(uint8_t) {}
+	void setMaxResults(uint8_t) {}
+	bool start(uint32_t duration, bool is_continue = false, bool restart = true) {
+		scanning = true;
+		++start_count;
+		return true;
+	}
+	bool stop() {
+		scanning = false;
+		return true;
+	}
+	bool isScanning() {
+		if (on_is_scanning) {
+			on_is_scanning();
+		}
+		return scanning;
+	}
+	// Called in the middle of the loop() checking the scan, like the NimBLE host task running concurrently
+	std::function<void()> on_is_scanning;
+	void clearResults() {}
+};
+
+struct NimBLEDevice {
+	static void init(const std::string&) {}
+	static NimBLEScan* getScan() {
+		static NimBLEScan scan;
+		return &scan;
+	}
+};
+using BLEDevice = NimBLEDevice;
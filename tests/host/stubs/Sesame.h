@@ -0,0 +1,77 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace libsesame3bt {
+
+enum class history_tag_type_t : uint8_t { none, open_sensor, remote_nano, other };
+constexpr size_t HISTORY_TAG_UUID_SIZE = 16;
+
+class Sesame {
+ public:
+	static constexpr const char* SESAME3_SRV_UUID = "0000fd81-0000-1000-8000-00805f9b34fb";
+	enum class model_t : int8_t {
+		unknown = -1,
+		sesame_3 = 0,
+		wifi_2,
+		sesame_bot,
+		sesame_bike,
+		sesame_4,
+		sesame_5,
+		sesame_bike_2,
+		sesame_5_pro,
+		open_sensor_1,
+		sesame_touch_pro,
+		sesame_touch,
+		hub3,
+		remote,
+		remote_nano,
+		sesame_5_us,
+		sesame_bot_2,
+		sesame_face_pro,
+		sesame_face,
+		sesame_6,
+		sesame_6_pro,
+		sesame_face_pro_ai,
+		sesame_face_ai,
+		open_sensor_2,
+	};
+	enum class motor_status_t : uint8_t { idle = 0, locking, holding, unlocking };
+	enum class result_code_t : uint8_t {
+		success = 0,
+		invalid_format,
+		not_supported,
+		storage_fail,
+		invalid_sig,
+		not_found,
+		unknown,
+		busy,
+		invalid_param
+	};
+	enum class history_type_t : uint8_t {
+		none = 0,
+		ble_lock,
+		ble_unlock,
+		time_changed,
+		autolock_updated,
+		mech_setting_updated,
+		autolock,
+		manual_locked,
+		manual_unlocked,
+		manual_else,
+		drive_locked,
+		drive_unlocked,
+		drive_failed,
+		ble_adv_param_updated,
+		wm2_lock,
+		wm2_unlock,
+		web_lock,
+		web_unlock,
+		ble_click,
+		wm2_click,
+		web_click,
+		drive_clicked
+	};
+};
+
+}  // namespace libsesame3bt
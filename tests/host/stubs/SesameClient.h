@@ -0,0 +1,202 @@
+#pragma once
+#include <NimBLEDevice.h>
+#include <esphome/core/hal.h>
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Sesame.h"
+
+namespace libsesame3bt {
+
+/**
+ * Fake SesameClient of the host harness. Connection state changes only when a test calls the fake_* methods, so that
+ * tests decide when a connection or authentication completes, unless `auto_complete_ms` is set.
+ */
+class SesameClient {
+ public:
+	static constexpr size_t MAX_CMD_TAG_SIZE = 21;
+	enum class state_t : int8_t { idle, connecting, connected, authenticating, active };
+
+	class Status {
+	 public:
+		Status() = default;
+		Status(bool in_lock, bool in_unlock, int16_t position, int16_t target, Sesame::motor_status_t motor = Sesame::motor_status_t::idle)
+		    : in_lock_(in_lock), in_unlock_(in_unlock), position_(position), target_(target), motor_(motor) {}
+		bool in_lock() const { return in_lock_; }
+		bool in_unlock() const { return in_unlock_; }
+		int16_t target() const { return target_; }
+		int16_t position() const { return position_; }
+		Sesame::motor_status_t motor_status() const { return motor_; }
+		uint8_t ret_code() const { return 0; }
+		float battery_pct() const { return battery_pct_; }
+		float voltage() const { return voltage_; }
+		bool battery_critical() const { return false; }
+		bool is_critical() const { return critical_; }
+		bool stopped() const { return motor_ == Sesame::motor_status_t::idle; }
+		static float scaled_voltage_to_pct(float scaled_voltage, Sesame::model_t) { return scaled_voltage * 10; }
+		Status& battery(float pct, float voltage) {
+			battery_pct_ = pct;
+			voltage_ = voltage;
+			return *this;
+		}
+		Status& critical(bool critical) {
+			critical_ = critical;
+			return *this;
+		}
+
+	 private:
+		bool in_lock_ = false;
+		bool in_unlock_ = false;
+		int16_t position_ = 0;
+		int16_t target_ = 0;
+		Sesame::motor_status_t motor_ = Sesame::motor_status_t::idle;
+		float battery_pct_ = 100;
+		float voltage_ = 6;
+		bool critical_ = false;
+	};
+
+	struct History {
+		Sesame::result_code_t result = Sesame::result_code_t::success;
+		Sesame::history_type_t type = Sesame::history_type_t::none;
+		int32_t record_id = 0;
+		size_t tag_len = 0;
+		char tag[MAX_CMD_TAG_SIZE + 1]{};
+		std::optional<history_tag_type_t> history_tag_type;
+		float scaled_voltage = 0;
+		float scaled_voltage2 = 0;
+		std::string extra;
+	};
+
+	using status_callback_t = std::function<void(SesameClient& client, Status status)>;
+	using history_callback_t = std::function<void(SesameClient& client, const History& history)>;
+
+	SesameClient() { instances().push_back(this); }
+	SesameClient(const SesameClient&) = delete;
+	static std::vector<SesameClient*>& instances() {
+		static std::vector<SesameClient*> list;
+		return list;
+	}
+
+	bool begin(const NimBLEAddress& address, Sesame::model_t model) {
+		++begin_count;
+		this->model = model;
+		this->address = address;
+		ble_client.peer_address = address;
+		return begin_result && address_accepted;
+	}
+	bool begin(const NimBLEUUID& uuid, Sesame::model_t model) {
+		++begin_count;
+		this->model = model;
+		address = {};
+		ble_client.peer_address = {};
+		return begin_result;
+	}
+	bool set_keys(std::string_view, std::string_view) { return true; }
+	void set_connect_timeout(uint32_t timeout) {}
+	bool connect_async() {
+		++connect_count;
+		if (connect_error) {
+			ble_client.last_error = connect_error;
+			return false;
+		}
+		state = state_t::connecting;
+		state_since = esphome::millis();
+		return true;
+	}
+	bool start_authenticate() {
+		state = state_t::authenticating;
+		state_since = esphome::millis();
+		return true;
+	}
+	void disconnect() { state = state_t::idle; }
+	bool lock(std::string_view tag) { return command("lock"); }
+	bool unlock(std::string_view tag) { return command("unlock"); }
+	bool lock(history_tag_type_t, const std::array<std::byte, HISTORY_TAG_UUID_SIZE>&) { return command("lock"); }
+	bool unlock(history_tag_type_t, const std::array<std::byte, HISTORY_TAG_UUID_SIZE>&) { return command("unlock"); }
+	bool click(std::string_view tag) { return command("click"); }
+	bool click(std::optional<uint8_t> script = std::nullopt) { return command("click"); }
+	bool request_history() {
+		++history_requests;
+		return state == state_t::active;
+	}
+	bool request_status() {
+		++status_requests;
+		return state == state_t::active;
+	}
+	state_t get_state() {
+		if (auto_complete_ms && esphome::millis() - state_since >= *auto_complete_ms) {
+			if (state == state_t::connecting) {
+				state = state_t::connected;
+			} else if (state == state_t::authenticating) {
+				state = state_t::active;
+				if (login_status) {
+					fake_status(*login_status);
+				}
+			}
+		}
+		return state;
+	}
+	Sesame::model_t get_model() const { return model; }
+	NimBLEClient* get_ble_client() { return &ble_client; }
+	const NimBLEClient* get_ble_client() const { return &ble_client; }
+	void set_status_callback(status_callback_t callback) { status_callback = std::move(callback); }
+	void set_history_callback(history_callback_t callback) { history_callback = std::move(callback); }
+
+	// Test controls
+	void fake_connected() { state = state_t::connected; }
+	void fake_connect_failed(int error) {
+		ble_client.last_error = error;
+		state = state_t::idle;
+	}
+	// Connected to `peer` found by UUID
+	void fake_connected(const NimBLEAddress& peer) {
+		ble_client.peer_address = peer;
+		state = state_t::connected;
+	}
+	void fake_authenticated() { state = state_t::active; }
+	void fake_disconnected() { state = state_t::idle; }
+	void fake_status(const Status& status) {
+		if (status_callback) {
+			status_callback(*this, status);
+		}
+	}
+	void fake_history(const History& history) {
+		if (history_callback) {
+			history_callback(*this, history);
+		}
+	}
+
+	state_t state = state_t::idle;
+	Sesame::model_t model = Sesame::model_t::unknown;
+	NimBLEClient ble_client;
+	// Address given to the last begin(), null if begun with UUID
+	NimBLEAddress address;
+	bool begin_result = true;
+	bool address_accepted = true;
+	int connect_error = 0;
+	int begin_count = 0;
+	int connect_count = 0;
+	int status_requests = 0;
+	int history_requests = 0;
+	std::vector<std::string> commands;
+	// Connection and authentication complete by themselves this many ms after they are started
+	std::optional<uint32_t> auto_complete_ms;
+	// Notified when an automatic authentication completes, like the status SESAME sends after login
+	std::optional<Status> login_status;
+
+ private:
+	uint32_t state_since = 0;
+	status_callback_t status_callback;
+	history_callback_t history_callback;
+
+	bool command(const char* name) {
+		commands.emplace_back(name);
+		return state == state_t::active;
+	}
+};
+
+}  // namespace libsesame3bt
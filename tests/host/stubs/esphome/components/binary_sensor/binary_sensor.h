@@ -0,0 +1,25 @@
+#pragma once
+#include <vector>
+#include "esphome/core/component.h"
+
+namespace esphome::binary_sensor {
+
+class BinarySensor : public EntityBase {
+ public:
+	bool state = false;
+	void publish_state(bool state) {
+		this->state = state;
+		flags_.has_state = true;
+		published.push_back(state);
+	}
+	void invalidate_state() { flags_.has_state = false; }
+	bool has_state() const { return flags_.has_state; }
+	std::vector<bool> published;
+
+ protected:
+	struct {
+		bool has_state;
+	} flags_{};
+};
+
+}  // namespace esphome::binary_sensor
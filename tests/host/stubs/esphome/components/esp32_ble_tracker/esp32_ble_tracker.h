@@ -0,0 +1,103 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#define ESP_UUID_LEN_16 2
+#define ESP_UUID_LEN_128 16
+
+struct esp_bt_uuid_t {
+	uint16_t len;
+	union {
+		uint16_t uuid16;
+		uint8_t uuid128[ESP_UUID_LEN_128];
+	} uuid;
+};
+
+namespace esphome::esp32_ble {
+
+class ESPBTUUID {
+ public:
+	static ESPBTUUID from_uint16(uint16_t uuid) {
+		ESPBTUUID ret;
+		ret.uuid_.len = ESP_UUID_LEN_16;
+		ret.uuid_.uuid.uuid16 = uuid;
+		return ret;
+	}
+	static ESPBTUUID from_raw(const uint8_t* data) {
+		ESPBTUUID ret;
+		ret.uuid_.len = ESP_UUID_LEN_128;
+		std::memcpy(ret.uuid_.uuid.uuid128, data, ESP_UUID_LEN_128);
+		return ret;
+	}
+	// "xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx", stored little endian like ESPHome
+	static ESPBTUUID from_raw(const std::string& data) {
+		ESPBTUUID ret;
+		ret.uuid_.len = ESP_UUID_LEN_128;
+		size_t n = 0;
+		for (size_t i = 0; i + 1 < data.size() && n < ESP_UUID_LEN_128; i++) {
+			if (data[i] == '-') {
+				continue;
+			}
+			ret.uuid_.uuid.uuid128[ESP_UUID_LEN_128 - 1 - n++] = std::stoul(data.substr(i++, 2), nullptr, 16);
+		}
+		return ret;
+	}
+	bool operator==(const ESPBTUUID& other) const {
+		return uuid_.len == other.uuid_.len && (uuid_.len == ESP_UUID_LEN_16 ? uuid_.uuid.uuid16 == other.uuid_.uuid.uuid16
+		                                                                     : !std::memcmp(uuid_.uuid.uuid128, other.uuid_.uuid.uuid128,
+		                                                                                    ESP_UUID_LEN_128));
+	}
+	esp_bt_uuid_t get_uuid() const { return uuid_; }
+	std::string to_string() const {
+		std::string ret;
+		char buf[3];
+		for (int i = uuid_.len == ESP_UUID_LEN_16 ? 1 : ESP_UUID_LEN_128 - 1; i >= 0; i--) {
+			std::snprintf(buf, sizeof(buf), "%02X", uuid_.len == ESP_UUID_LEN_16 ? (uuid_.uuid.uuid16 >> (i * 8)) & 0xff : uuid_.uuid.uuid128[i]);
+			ret += buf;
+		}
+		return ret;
+	}
+
+ private:
+	esp_bt_uuid_t uuid_{};
+};
+
+}  // namespace esphome::esp32_ble
+
+namespace esphome::esp32_ble_tracker {
+
+struct ServiceData {
+	esp32_ble::ESPBTUUID uuid;
+	std::vector<uint8_t> data;
+};
+
+class ESPBTDevice {
+ public:
+	uint64_t address_uint64() const { return address; }
+	std::string address_str() const {
+		char buf[18];
+		std::snprintf(buf, sizeof(buf), "%02X:%02X:%02X:%02X:%02X:%02X", static_cast<uint8_t>(address >> 40),
+		              static_cast<uint8_t>(address >> 32), static_cast<uint8_t>(address >> 24), static_cast<uint8_t>(address >> 16),
+		              static_cast<uint8_t>(address >> 8), static_cast<uint8_t>(address));
+		return buf;
+	}
+	const std::string& get_name() const { return name; }
+	const std::vector<esp32_ble::ESPBTUUID>& get_service_uuids() const { return service_uuids; }
+	const std::vector<ServiceData>& get_manufacturer_datas() const { return manufacturer_datas; }
+
+	uint64_t address = 0;
+	std::string name;
+	std::vector<esp32_ble::ESPBTUUID> service_uuids;
+	std::vector<ServiceData> manufacturer_datas;
+};
+
+class ESPBTDeviceListener {
+ public:
+	virtual ~ESPBTDeviceListener() = default;
+	virtual bool parse_device(const ESPBTDevice& device) = 0;
+};
+
+}  // namespace esphome::esp32_ble_tracker
@@ -0,0 +1,66 @@
+#pragma once
+#include "esphome/core/component.h"
+#include "esphome/core/log.h"
+
+namespace esphome::lock {
+
+enum LockState : uint8_t {
+	LOCK_STATE_NONE = 0,
+	LOCK_STATE_LOCKED,
+	LOCK_STATE_UNLOCKED,
+	LOCK_STATE_JAMMED,
+	LOCK_STATE_LOCKING,
+	LOCK_STATE_UNLOCKING
+};
+const char* lock_state_to_string(LockState state);
+
+struct LockTraits {
+	bool supports_open = false;
+	void set_supports_open(bool supports_open) { this->supports_open = supports_open; }
+};
+
+class Lock;
+class LockCall {
+ public:
+	explicit LockCall(Lock* parent) : parent_(parent) {}
+	const optional<LockState>& get_state() const { return state_; }
+	LockCall& set_state(LockState state) {
+		state_ = state;
+		return *this;
+	}
+	void perform();
+
+ private:
+	Lock* parent_;
+	optional<LockState> state_;
+};
+
+class Lock : public EntityBase {
+	friend class LockCall;
+
+ public:
+	virtual ~Lock() = default;
+	LockCall make_call() { return LockCall{this}; }
+	void lock() { make_call().set_state(LOCK_STATE_LOCKED).perform(); }
+	void unlock() { make_call().set_state(LOCK_STATE_UNLOCKED).perform(); }
+	void open() { open_latch(); }
+	void publish_state(LockState state) {
+		this->state = state;
+		state_callback_.call(state);
+	}
+	void add_on_state_callback(std::function<void(LockState)>&& callback) { state_callback_.add(std::move(callback)); }
+	LockState state = LOCK_STATE_NONE;
+	LockTraits traits;
+
+ protected:
+	virtual void control(const LockCall& call) = 0;
+	virtual void open_latch() {}
+	CallbackManager<void(LockState)> state_callback_{};
+};
+
+inline void
+LockCall::perform() {
+	parent_->control(*this);
+}
+
+}  // namespace esphome::lock
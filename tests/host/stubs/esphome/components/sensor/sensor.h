@@ -0,0 +1,23 @@
+#pragma once
+#include <vector>
+#include "esphome/core/component.h"
+
+namespace esphome::sensor {
+
+class Sensor : public EntityBase {
+ public:
+	float state = NAN;
+	void publish_state(float state) {
+		this->state = state;
+		has_state_ = true;
+		published.push_back(state);
+	}
+	bool has_state() const { return has_state_; }
+	// Values published so far
+	std::vector<float> published;
+
+ private:
+	bool has_state_ = false;
+};
+
+}  // namespace esphome::sensor
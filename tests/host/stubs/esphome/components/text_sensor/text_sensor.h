@@ -0,0 +1,25 @@
+#pragma once
+#include <vector>
+#include "esphome/core/component.h"
+
+namespace esphome::text_sensor {
+
+class TextSensor : public EntityBase {
+ public:
+	std::string state;
+	void publish_state(const std::string& state) {
+		this->state = state;
+		if (keep_published) {
+			published.push_back(state);
+		}
+	}
+	void publish_state(const char* state, size_t len) {
+		this->state.assign(state, len);
+		publish_state(this->state);
+	}
+	// Values published so far, unless turned off to count the allocations of the publisher only
+	std::vector<std::string> published;
+	bool keep_published = true;
+};
+
+}  // namespace esphome::text_sensor
@@ -0,0 +1,11 @@
+#pragma once
+
+namespace esphome {
+
+struct Application {
+	int reboot_count = 0;
+	void safe_reboot() { ++reboot_count; }
+};
+extern Application App;
+
+}  // namespace esphome
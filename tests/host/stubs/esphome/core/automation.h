@@ -0,0 +1,24 @@
+#pragma once
+#include "esphome/core/component.h"
+
+namespace esphome {
+
+template <typename... Ts>
+class TemplatableValue {};
+template <typename... Ts>
+class Action {
+ public:
+	virtual void play(Ts... x) = 0;
+};
+template <typename T>
+class Parented {
+ public:
+	Parented() {}
+	Parented(T* parent) : parent_(parent) {}
+	void set_parent(T* parent) { parent_ = parent; }
+
+ protected:
+	T* parent_{nullptr};
+};
+
+}  // namespace esphome
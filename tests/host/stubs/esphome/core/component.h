@@ -0,0 +1,93 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/optional.h"
+
+namespace esphome {
+
+namespace setup_priority {
+
+inline constexpr float DATA = 600.0f;
+inline constexpr float AFTER_WIFI = 200.0f;
+
+}  // namespace setup_priority
+
+inline constexpr uint32_t SCHEDULER_DONT_RUN = 4294967295UL;
+
+class Component;
+
+namespace host {
+
+// Scheduler of the host harness, run by host::run() on the virtual clock
+void schedule(Component* component, const std::string& name, uint32_t delay, std::function<void()>&& func, bool repeat);
+bool cancel(Component* component, const std::string& name);
+
+}  // namespace host
+
+class Component {
+ public:
+	virtual ~Component() = default;
+	virtual void setup() {}
+	virtual void loop() {}
+	virtual void dump_config() {}
+	virtual float get_setup_priority() const { return 0; }
+	void mark_failed() { failed_ = true; }
+	bool is_failed() const { return failed_; }
+	void status_set_warning(const char* = nullptr) { warning_ = true; }
+	bool status_has_warning() const { return warning_; }
+	void disable_loop() { loop_enabled_ = false; }
+	void enable_loop() { loop_enabled_ = true; }
+	void enable_loop_soon_any_context() { loop_enabled_ = true; }
+	bool is_loop_enabled() const { return loop_enabled_; }
+
+ protected:
+	void defer(std::function<void()>&& func) { host::schedule(this, "", 0, std::move(func), false); }
+	void set_timeout(uint32_t timeout, std::function<void()>&& func) { host::schedule(this, "", timeout, std::move(func), false); }
+	void set_timeout(const std::string& name, uint32_t timeout, std::function<void()>&& func) {
+		host::schedule(this, name, timeout, std::move(func), false);
+	}
+	void set_timeout(const char* name, uint32_t timeout, std::function<void()>&& func) {
+		host::schedule(this, name, timeout, std::move(func), false);
+	}
+	bool cancel_timeout(const char* name) { return host::cancel(this, name); }
+	void set_interval(const char* name, uint32_t interval, std::function<void()>&& func) {
+		host::schedule(this, name, interval, std::move(func), true);
+	}
+	bool cancel_interval(const char* name) { return host::cancel(this, name); }
+
+ private:
+	bool failed_ = false;
+	bool warning_ = false;
+	bool loop_enabled_ = true;
+};
+
+class PollingComponent : public Component {
+ public:
+	virtual void update() = 0;
+	virtual void set_update_interval(uint32_t interval) { update_interval_ = interval; }
+	uint32_t get_update_interval() const { return update_interval_; }
+	void start_poller() {
+		if (update_interval_ != SCHEDULER_DONT_RUN) {
+			set_interval("update", update_interval_, [this]() { update(); });
+		}
+	}
+	void stop_poller() { cancel_interval("update"); }
+
+ protected:
+	uint32_t update_interval_ = SCHEDULER_DONT_RUN;
+};
+
+class EntityBase {
+ public:
+	const std::string& get_name() const { return name_; }
+	void set_name(const char* name) { name_ = name; }
+
+ protected:
+	std::string name_;
+};
+
+}  // namespace esphome
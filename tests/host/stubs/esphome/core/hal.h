@@ -0,0 +1,10 @@
+#pragma once
+#include <cstdint>
+
+namespace esphome {
+
+// Virtual clock of the host harness
+uint32_t millis();
+uint32_t micros();
+
+}  // namespace esphome
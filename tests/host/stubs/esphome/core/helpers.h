@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "esphome/core/optional.h"
+
+namespace esphome {
+
+uint32_t random_uint32();
+uint32_t fnv1_hash(const std::string& str);
+
+template <typename... Ts>
+class CallbackManager;
+template <typename... Ts>
+class CallbackManager<void(Ts...)> {
+ public:
+	void add(std::function<void(Ts...)>&& callback) { callbacks_.push_back(std::move(callback)); }
+	void call(Ts... args) {
+		for (auto& cb : callbacks_) {
+			cb(args...);
+		}
+	}
+
+ private:
+	std::vector<std::function<void(Ts...)>> callbacks_;
+};
+
+class StringRef {
+ public:
+	StringRef(const std::string& str) : str_(str.c_str()), size_(str.size()) {}
+	const char* c_str() const { return str_; }
+	size_t size() const { return size_; }
+
+ private:
+	const char* str_;
+	size_t size_;
+};
+
+}  // namespace esphome
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdio>
+
+#define ESPHOME_LOG_LEVEL_NONE 0
+#define ESPHOME_LOG_LEVEL_ERROR 1
+#define ESPHOME_LOG_LEVEL_WARN 2
+#define ESPHOME_LOG_LEVEL_INFO 3
+#define ESPHOME_LOG_LEVEL_CONFIG 4
+#define ESPHOME_LOG_LEVEL_DEBUG 5
+#define ESPHOME_LOG_LEVEL_VERBOSE 6
+#ifndef ESPHOME_LOG_LEVEL
+#define ESPHOME_LOG_LEVEL ESPHOME_LOG_LEVEL_DEBUG
+#endif
+
+namespace esphome {
+
+// Printed only when SESAME_HOST_LOG is set in the environment
+void host_log(char level, const char* tag, const char* format, ...) __attribute__((format(printf, 3, 4)));
+
+}  // namespace esphome
+
+#define ESP_LOGE(tag, ...) ::esphome::host_log('E', tag, __VA_ARGS__)
+#define ESP_LOGW(tag, ...) ::esphome::host_log('W', tag, __VA_ARGS__)
+#define ESP_LOGI(tag, ...) ::esphome::host_log('I', tag, __VA_ARGS__)
+#define ESP_LOGD(tag, ...) ::esphome::host_log('D', tag, __VA_ARGS__)
+#define ESP_LOGV(tag, ...) ::esphome::host_log('V', tag, __VA_ARGS__)
+#define ESP_LOGCONFIG(tag, ...) ::esphome::host_log('C', tag, __VA_ARGS__)
+#define LOG_STR_ARG(s) (s)
+#define LOG_SENSOR(prefix, type, obj) (void)(obj)
+#define LOG_TEXT_SENSOR(prefix, type, obj) (void)(obj)
+#define LOG_BINARY_SENSOR(prefix, type, obj) (void)(obj)
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <vector>
+
+namespace esphome {
+
+/**
+ * In-memory preferences, kept across "reboots" of components within one test process.
+ */
+class ESPPreferenceObject {
+ public:
+	ESPPreferenceObject() = default;
+	ESPPreferenceObject(std::vector<uint8_t>* storage) : storage_(storage) {}
+	template <typename T>
+	bool save(const T* src) {
+		if (!storage_) {
+			return false;
+		}
+		storage_->assign(reinterpret_cast<const uint8_t*>(src), reinterpret_cast<const uint8_t*>(src) + sizeof(T));
+		++save_count;
+		return true;
+	}
+	template <typename T>
+	bool load(T* dest) {
+		if (!storage_ || storage_->size() != sizeof(T)) {
+			return false;
+		}
+		std::memcpy(dest, storage_->data(), sizeof(T));
+		return true;
+	}
+	static inline int save_count = 0;
+
+ private:
+	std::vector<uint8_t>* storage_ = nullptr;
+};
+
+class ESPPreferences {
+ public:
+	template <typename T>
+	ESPPreferenceObject make_preference(uint32_t type, bool in_flash) {
+		return {&storage_[type]};
+	}
+	template <typename T>
+	ESPPreferenceObject make_preference(uint32_t type) {
+		return {&storage_[type]};
+	}
+	bool sync() { return true; }
+	void clear() { storage_.clear(); }
+
+ private:
+	std::map<uint32_t, std::vector<uint8_t>> storage_;
+};
+extern ESPPreferences* global_preferences;
+
+}  // namespace esphome
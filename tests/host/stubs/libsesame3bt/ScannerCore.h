@@ -0,0 +1,15 @@
+#pragma once
+#include <cstddef>
+#include <string_view>
+#include "../Sesame.h"
+
+namespace libsesame3bt::core {
+
+struct adv_result {
+	Sesame::model_t model;
+	std::byte flag_byte;
+	bool is_valid;
+};
+adv_result parse_advertisement(std::string_view manu_data, std::string_view name, uint8_t* uuid);
+
+}  // namespace libsesame3bt::core
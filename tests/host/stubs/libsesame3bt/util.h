@@ -0,0 +1,8 @@
+#pragma once
+#include <string>
+
+namespace libsesame3bt::core::util {
+
+std::string bin2hex(const char* data, size_t len);
+
+}  // namespace libsesame3bt::core::util
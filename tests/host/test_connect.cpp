@@ -0,0 +1,299 @@
+#include <esphome/core/helpers.h>
+#include <esphome/core/preferences.h>
+#include <sesame/sesame_component.h>
+#include <cstdio>
+#include "host.h"
+
+using esphome::binary_sensor::BinarySensor;
+using esphome::sesame_lock::SesameComponent;
+using libsesame3bt::Sesame;
+using libsesame3bt::SesameClient;
+
+namespace {
+
+constexpr const char* PUBKEY = "00";
+constexpr const char* SECRET = "00";
+constexpr const char* UUID = "00112233-4455-6677-8899-aabbccddeeff";
+
+struct device {
+	SesameComponent component;
+	SesameClient& client;
+	BinarySensor connection;
+
+	explicit device(const char* id, const char* btaddr = "", const char* uuid = "")
+	    : component(id), client(*SesameClient::instances().back()) {
+		component.set_connection_sensor(&connection);
+		component.init(Sesame::model_t::sesame_5, PUBKEY, SECRET, btaddr, uuid);
+	}
+	bool connected() const { return !connection.published.empty() && connection.published.back(); }
+};
+
+// Complete connection and authentication of `dev` as soon as it is attempted
+void
+accept(device& dev, std::initializer_list<esphome::Component*> all) {
+	host::run(all, 100);
+	dev.client.fake_connected();
+	host::run(all, 100);
+	dev.client.fake_authenticated();
+	host::run(all, 100);
+}
+
+esphome::ESPPreferenceObject
+address_pref() {
+	return esphome::global_preferences->make_preference<uint64_t>(esphome::fnv1_hash(std::string{"sesame_address_"} + UUID), true);
+}
+
+}  // namespace
+
+int
+main() {
+	host::test("connect and authenticate", [] {
+		device dev{"s1", "01:02:03:04:05:06"};
+		host::setup({&dev.component});
+		host::run({&dev.component}, 100);
+		CHECK(dev.client.connect_count == 1);
+		CHECK(dev.client.state == SesameClient::state_t::connecting);
+		dev.client.fake_connected();
+		host::run({&dev.component}, 100);
+		CHECK(dev.client.state == SesameClient::state_t::authenticating);
+		dev.client.fake_authenticated();
+		host::run({&dev.component}, 100);
+		CHECK(dev.connected());
+		CHECK(!dev.component.is_failed());
+	});
+	host::test("reconnect with backoff after a failure", [] {
+		device dev{"s1", "01:02:03:04:05:06"};
+		dev.component.set_connect_retry_interval(1'000, 8'000);
+		host::setup({&dev.component});
+		host::run({&dev.component}, 100);
+		dev.client.fake_connect_failed(13);
+		host::run({&dev.component}, 100);
+		CHECK(dev.client.connect_count == 1);
+		// 1000 ms +-25%
+		host::run({&dev.component}, 700);
+		CHECK(dev.client.connect_count == 1);
+		host::run({&dev.component}, 600);
+		CHECK(dev.client.connect_count == 2);
+	});
+	host::test("one connection at a time with one slot", [] {
+		device a{"a", "01:02:03:04:05:06"};
+		device b{"b", "01:02:03:04:05:07"};
+		host::setup({&a.component, &b.component});
+		host::run({&a.component, &b.component}, 100);
+		CHECK(a.client.connect_count + b.client.connect_count == 1);
+		auto& first = a.client.connect_count ? a : b;
+		auto& second = a.client.connect_count ? b : a;
+		first.client.fake_connected();
+		host::run({&a.component, &b.component}, 100);
+		CHECK(second.client.connect_count == 1);
+	});
+	host::test("slot kept while another link is being established", [] {
+		device a{"a", "01:02:03:04:05:06"};
+		device b{"b", "01:02:03:04:05:07"};
+		a.component.set_connect_slots(2);
+		host::setup({&a.component, &b.component});
+		b.client.connect_error = BLE_HS_EALREADY;
+		host::run({&a.component, &b.component}, 100);
+		CHECK(a.client.connect_count == 1);
+		CHECK(b.client.connect_count > 1);
+		b.client.connect_error = 0;
+		host::run({&a.component, &b.component}, 100);
+		CHECK(b.client.state == SesameClient::state_t::connecting);
+	});
+	host::test("time waiting for the radio measured as a phase", [] {
+		esphome::sensor::Sensor wait_radio;
+		device a{"a", "01:02:03:04:05:06"};
+		device b{"b", "01:02:03:04:05:07"};
+		a.component.set_connect_slots(2);
+		b.component.set_phase_latency_sensor(esphome::sesame_lock::state_t::wait_radio, esphome::sesame_lock::latency_stat_t::last,
+		                                     &wait_radio);
+		host::setup({&a.component, &b.component});
+		b.client.connect_error = BLE_HS_EALREADY;
+		host::run({&a.component, &b.component}, 500);
+		CHECK(wait_radio.published.empty());
+		b.client.connect_error = 0;
+		host::run({&a.component, &b.component}, 100);
+		CHECK(b.client.state == SesameClient::state_t::connecting);
+		CHECK(wait_radio.published.size() == 1 && wait_radio.published.back() >= 450);
+	});
+	host::test("give up waiting for the radio", [] {
+		device a{"a", "01:02:03:04:05:06"};
+		device b{"b", "01:02:03:04:05:07"};
+		a.component.set_connect_slots(2);
+		b.component.set_connect_retry_limit(1);
+		host::setup({&a.component, &b.component});
+		b.client.connect_error = BLE_HS_EALREADY;
+		accept(a, {&a.component, &b.component});
+		CHECK(a.connected());
+		// 10 s radio wait, then 5 s before reboot for the retry limit
+		host::run({&a.component, &b.component}, 14'000);
+		CHECK(!b.component.is_failed());
+		host::run({&a.component, &b.component}, 2'000);
+		CHECK(b.component.is_failed());
+		CHECK(!a.component.is_failed());
+	});
+	host::test("loop sleeps while connected and idle", [] {
+		device dev{"s1", "01:02:03:04:05:06"};
+		host::setup({&dev.component});
+		accept(dev, {&dev.component});
+		CHECK(dev.connected());
+		auto calls = host::loop_calls(&dev.component);
+		host::run({&dev.component}, 10'000);
+		// Woken once per second instead of every loop (625 loops)
+		CHECK(host::loop_calls(&dev.component) - calls <= 20);
+	});
+	host::test("going idle does not touch the scheduler", [] {
+		device dev{"s1", "01:02:03:04:05:06"};
+		host::setup({&dev.component});
+		accept(dev, {&dev.component});
+		host::run({&dev.component}, 2'000);
+		auto schedules = host::schedule_calls(&dev.component);
+		for (int i = 0; i < 20; i++) {
+			dev.client.fake_status(SesameClient::Status{true, false, 10, 10});
+			host::run({&dev.component}, 2'000);
+		}
+		CHECK(host::schedule_calls(&dev.component) == schedules);
+	});
+	host::test("time to authenticated and to first publish", [] {
+		esphome::sensor::Sensor pct;
+		device dev{"s1", "01:02:03:04:05:06"};
+		dev.component.set_battery_pct_sensor(&pct);
+		dev.client.auto_complete_ms = 200;
+		dev.client.login_status = SesameClient::Status{true, false, 10, 10}.battery(80, 5.8);
+		host::setup({&dev.component});
+		auto to_authenticated = host::run_until({&dev.component}, [&] { return dev.connected(); }, 5'000);
+		auto to_publish = to_authenticated + host::run_until({&dev.component}, [&] { return !pct.published.empty(); }, 5'000);
+		// 200 ms each for connection and authentication, the rest is added by the component
+		CHECK(to_authenticated <= 500);
+		CHECK(to_publish <= to_authenticated + 50);
+		const auto& cost = host::loop_cost(&dev.component);
+		auto calls = host::loop_calls(&dev.component);
+		std::printf("authenticated in %lu ms, first publish in %lu ms, loop %.1f us per call (max %.1f us)\n",
+		            static_cast<unsigned long>(to_authenticated), static_cast<unsigned long>(to_publish),
+		            cost.total_ns / 1e3 / calls, cost.max_ns / 1e3);
+	});
+	host::test("status notification wakes the loop", [] {
+		esphome::sensor::Sensor pct;
+		device dev{"s1", "01:02:03:04:05:06"};
+		dev.component.set_battery_pct_sensor(&pct);
+		host::setup({&dev.component});
+		accept(dev, {&dev.component});
+		dev.client.fake_status(SesameClient::Status{true, false, 10, 10}.battery(80, 5.8));
+		host::run({&dev.component}, 16);
+		CHECK(!pct.published.empty() && pct.published.back() == 80);
+	});
+	host::test("address found by UUID is cached", [] {
+		device dev{"s1", "", UUID};
+		host::setup({&dev.component});
+		host::run({&dev.component}, 100);
+		CHECK(dev.client.address.isNull());
+		dev.client.fake_connected(NimBLEAddress{0x1234, BLE_ADDR_RANDOM});
+		host::run({&dev.component}, 100);
+		dev.client.fake_authenticated();
+		host::run({&dev.component}, 100);
+		uint64_t cached = 0;
+		CHECK(address_pref().load(&cached) && cached == 0x1234);
+	});
+	host::test("cached address used at boot", [] {
+		uint64_t cached = 0x1234;
+		address_pref().save(&cached);
+		device dev{"s1", "", UUID};
+		host::setup({&dev.component});
+		CHECK(dev.client.address == NimBLEAddress(0x1234, BLE_ADDR_RANDOM));
+		CHECK(!dev.component.is_failed());
+	});
+	host::test("unusable cached address falls back to UUID", [] {
+		uint64_t cached = 0x1234;
+		address_pref().save(&cached);
+		device dev{"s1", "", UUID};
+		dev.client.address_accepted = false;
+		host::setup({&dev.component});
+		CHECK(!dev.component.is_failed());
+		CHECK(dev.client.address.isNull());
+		CHECK(address_pref().load(&cached) && cached == 0);
+		host::run({&dev.component}, 100);
+		CHECK(dev.client.connect_count == 1);
+	});
+	host::test("connect failure with cached address falls back to UUID", [] {
+		uint64_t cached = 0x1234;
+		address_pref().save(&cached);
+		device dev{"s1", "", UUID};
+		host::setup({&dev.component});
+		host::run({&dev.component}, 100);
+		dev.client.fake_connect_failed(13);
+		host::run({&dev.component}, 100);
+		CHECK(!dev.component.is_failed());
+		CHECK(dev.client.address.isNull());
+		CHECK(address_pref().load(&cached) && cached == 0);
+	});
+	host::test("begin failure with the configured address is fatal", [] {
+		esphome::sesame_lock::SesameComponent component{"s1"};
+		SesameClient::instances().back()->address_accepted = false;
+		component.init(Sesame::model_t::sesame_5, PUBKEY, SECRET, "01:02:03:04:05:06", "");
+		CHECK(component.is_failed());
+	});
+	host::test("suppressed publish leaves the sensor state", [] {
+		esphome::sensor::Sensor pct;
+		device dev{"s1", "01:02:03:04:05:06"};
+		dev.component.set_battery_pct_sensor(&pct);
+		dev.component.set_publish_filter(5, 0.1, 0);
+		host::setup({&dev.component});
+		accept(dev, {&dev.component});
+		dev.client.fake_status(SesameClient::Status{true, false, 10, 10}.battery(80, 5.8));
+		host::run({&dev.component}, 16);
+		dev.client.fake_status(SesameClient::Status{true, false, 10, 10}.battery(78, 5.8));
+		host::run({&dev.component}, 16);
+		CHECK(pct.published == std::vector<float>{80});
+		CHECK(pct.state == 80);
+		dev.client.fake_status(SesameClient::Status{true, false, 10, 10}.battery(70, 5.8));
+		host::run({&dev.component}, 16);
+		CHECK((pct.published == std::vector<float>{80, 70}));
+	});
+	host::test("passive mode gets the first status at boot", [] {
+		esphome::sensor::Sensor pct;
+		device dev{"s1", "01:02:03:04:05:06"};
+		dev.component.set_battery_pct_sensor(&pct);
+		dev.component.set_passive(true);
+		dev.component.set_always_connect(false);
+		dev.component.set_update_interval(3'600'000);
+		host::setup({&dev.component});
+		host::run({&dev.component}, 1'000);
+		CHECK(dev.client.connect_count == 0);
+		host::advertise("01:02:03:04:05:06");
+		accept(dev, {&dev.component});
+		CHECK(dev.client.connect_count == 1);
+		dev.client.fake_status(SesameClient::Status{true, false, 10, 10}.battery(80, 5.8));
+		host::run({&dev.component}, 100);
+		CHECK(!pct.published.empty() && pct.published.back() == 80);
+		// Disconnected after the status, which is kept while advertised
+		CHECK(dev.client.state == SesameClient::state_t::idle);
+		CHECK(!dev.connected());
+		host::advertise("01:02:03:04:05:06");
+		host::run({&dev.component}, 10'000);
+		CHECK(pct.published.back() == 80);
+	});
+	host::test("passive status kept when advertised during the loop", [] {
+		esphome::sensor::Sensor pct;
+		device dev{"s1", "01:02:03:04:05:06"};
+		dev.component.set_battery_pct_sensor(&pct);
+		dev.component.set_passive(true);
+		dev.component.set_always_connect(false);
+		dev.component.set_update_interval(3'600'000);
+		host::setup({&dev.component});
+		host::run({&dev.component}, 1'000);
+		host::advertise("01:02:03:04:05:06");
+		accept(dev, {&dev.component});
+		dev.client.fake_status(SesameClient::Status{true, false, 10, 10}.battery(80, 5.8));
+		host::run({&dev.component}, 100);
+		CHECK(!pct.published.empty() && pct.published.back() == 80);
+		// The advertisement lands after loop() has read millis()
+		NimBLEDevice::getScan()->on_is_scanning = [] {
+			host::advance(1);
+			host::advertise("01:02:03:04:05:06");
+		};
+		auto published = pct.published.size();
+		host::run({&dev.component}, 10'000);
+		CHECK(pct.published.size() == published);
+	});
+	return host::finish();
+}
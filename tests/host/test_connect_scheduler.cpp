@@ -0,0 +1,81 @@
+#include <NimBLEDevice.h>
+#include <sesame/connect_scheduler.h>
+#include "host.h"
+
+using esphome::sesame_lock::connect_priority_t;
+using esphome::sesame_lock::ConnectScheduler;
+using esphome::sesame_lock::SesameComponent;
+
+namespace {
+
+SesameComponent* const a = reinterpret_cast<SesameComponent*>(0x10);
+SesameComponent* const b = reinterpret_cast<SesameComponent*>(0x20);
+
+}  // namespace
+
+int
+main() {
+	host::test("admits in order within the slot limit", [] {
+		ConnectScheduler s;
+		s.init(3);
+		CHECK(s.enqueue(a, connect_priority_t::background, 0));
+		CHECK(s.enqueue(b, connect_priority_t::background, 0));
+		CHECK(!s.try_admit(b, 0));
+		CHECK(s.try_admit(a, 0));
+		CHECK(!s.try_admit(b, 0));
+		s.release(a);
+		CHECK(s.try_admit(b, 0));
+	});
+	host::test("command priority goes first", [] {
+		ConnectScheduler s;
+		s.init(3);
+		s.enqueue(a, connect_priority_t::background, 0);
+		s.enqueue(b, connect_priority_t::command, 0);
+		CHECK(!s.try_admit(a, 0));
+		CHECK(s.try_admit(b, 0));
+	});
+	host::test("raising priority of a waiting entry", [] {
+		ConnectScheduler s;
+		s.init(3);
+		s.enqueue(a, connect_priority_t::background, 0);
+		s.enqueue(b, connect_priority_t::status, 0);
+		s.enqueue(a, connect_priority_t::command, 0);
+		CHECK(s.try_admit(a, 0));
+	});
+	host::test("aging prevents starvation", [] {
+		ConnectScheduler s;
+		s.init(3);
+		constexpr uint32_t now = ConnectScheduler::AGING_STEP * 2;
+		s.enqueue(a, connect_priority_t::background, 0);
+		s.enqueue(b, connect_priority_t::status, now);
+		// a waited two aging steps and is now above the fresh status request
+		CHECK(!s.try_admit(b, now));
+		CHECK(s.try_admit(a, now));
+	});
+	host::test("aged entry yields to a command on a tie", [] {
+		ConnectScheduler s;
+		s.init(3);
+		constexpr uint32_t now = ConnectScheduler::AGING_STEP * 2;
+		s.enqueue(a, connect_priority_t::background, 0);
+		s.enqueue(b, connect_priority_t::command, now);
+		CHECK(!s.try_admit(a, now));
+		CHECK(s.try_admit(b, now));
+	});
+	host::test("slots are clamped to NimBLE connections", [] {
+		ConnectScheduler s;
+		s.init(3);
+		s.set_slots(9);
+		CHECK(s.get_slots() == CONFIG_BT_NIMBLE_MAX_CONNECTIONS);
+		s.enqueue(a, connect_priority_t::background, 0);
+		s.enqueue(b, connect_priority_t::background, 0);
+		CHECK(s.try_admit(a, 0));
+		CHECK(s.try_admit(b, 0));
+	});
+	host::test("queue overflow is rejected", [] {
+		ConnectScheduler s;
+		s.init(1);
+		CHECK(s.enqueue(a, connect_priority_t::background, 0));
+		CHECK(!s.enqueue(b, connect_priority_t::background, 0));
+	});
+	return host::finish();
+}
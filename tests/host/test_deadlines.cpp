@@ -0,0 +1,48 @@
+#include <sesame/deadlines.h>
+#include "host.h"
+
+using esphome::sesame_lock::Deadlines;
+
+namespace {
+
+enum class test_timer_t : uint8_t { first, second, count };
+
+}  // namespace
+
+int
+main() {
+	host::test("expire once at the deadline", [] {
+		Deadlines<test_timer_t> d;
+		d.arm(test_timer_t::first, 1'000, 500);
+		CHECK(d.armed(test_timer_t::first));
+		CHECK(!d.any_expired(1'499));
+		CHECK(!d.expire(test_timer_t::first, 1'499));
+		CHECK(d.any_expired(1'500));
+		CHECK(d.expire(test_timer_t::first, 1'500));
+		CHECK(!d.armed(test_timer_t::first));
+		CHECK(!d.expire(test_timer_t::first, 2'000));
+	});
+	host::test("cancel and independent timers", [] {
+		Deadlines<test_timer_t> d;
+		d.arm(test_timer_t::first, 0, 100);
+		d.arm(test_timer_t::second, 0, 200);
+		CHECK(d.any_armed_except(test_timer_t::second));
+		d.cancel(test_timer_t::first);
+		CHECK(d.any_armed());
+		CHECK(!d.any_armed_except(test_timer_t::second));
+		CHECK(!d.any_expired(150));
+		CHECK(d.expire(test_timer_t::second, 200));
+		CHECK(!d.any_armed());
+	});
+	host::test("millis() wrap around", [] {
+		host::reset_clock(0xffff'ff00);
+		Deadlines<test_timer_t> d;
+		d.arm(test_timer_t::first, host::now(), 0x200);
+		host::advance(0x100);
+		CHECK(host::now() == 0);
+		CHECK(!d.any_expired(host::now()));
+		host::advance(0x100);
+		CHECK(d.expire(test_timer_t::first, host::now()));
+	});
+	return host::finish();
+}
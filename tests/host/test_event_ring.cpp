@@ -0,0 +1,51 @@
+#include <sesame/event_ring.h>
+#include <atomic>
+#include <thread>
+#include "host.h"
+
+using esphome::sesame_lock::EventRing;
+
+int
+main() {
+	host::test("fifo and overflow count", [] {
+		EventRing<int, 4> ring;
+		for (int i = 0; i < 6; i++) {
+			ring.push(i);
+		}
+		CHECK(ring.get_overflows() == 2);
+		int v;
+		for (int i = 0; i < 4; i++) {
+			CHECK(ring.pop(v) && v == i);
+		}
+		CHECK(!ring.pop(v));
+		CHECK(ring.empty());
+	});
+	host::test("one producer thread and one consumer thread", [] {
+		constexpr int COUNT = 200'000;
+		EventRing<int, 8> ring;
+		std::thread producer([&] {
+			for (int i = 0; i < COUNT; i++) {
+				ring.push(i);
+			}
+		});
+		int received = 0;
+		int last = -1;
+		bool ordered = true;
+		auto drain = [&] {
+			int v;
+			while (ring.pop(v)) {
+				ordered &= v > last;
+				last = v;
+				++received;
+			}
+		};
+		while (last < COUNT - 1 && received + static_cast<int>(ring.get_overflows()) < COUNT) {
+			drain();
+		}
+		producer.join();
+		drain();
+		CHECK(ordered);
+		CHECK(received + static_cast<int>(ring.get_overflows()) == COUNT);
+	});
+	return host::finish();
+}
@@ -0,0 +1,147 @@
+#include <sesame/lock_feature.h>
+#include <sesame/sesame_component.h>
+#include <sesame_group/sesame_group.h>
+#include "host.h"
+
+using esphome::sensor::Sensor;
+using esphome::sesame_group::SesameGroup;
+using esphome::sesame_lock::SesameComponent;
+using esphome::sesame_lock::SesameLock;
+using esphome::text_sensor::TextSensor;
+using libsesame3bt::Sesame;
+using libsesame3bt::SesameClient;
+using motor_status_t = Sesame::motor_status_t;
+
+namespace {
+
+const SesameClient::Status LOCKED{true, false, 0, 0};
+const SesameClient::Status UNLOCKED{false, true, 100, 100};
+const SesameClient::Status LOCKING{false, false, 50, 0, motor_status_t::locking};
+
+struct device {
+	SesameComponent component;
+	SesameClient& client;
+	SesameLock lock;
+
+	device(const char* id, const char* btaddr)
+	    : component(id), client(*SesameClient::instances().back()), lock(&component, Sesame::model_t::sesame_5, "esphome") {
+		component.set_feature(&lock);
+		lock.init();
+		component.init(Sesame::model_t::sesame_5, "00", "00", btaddr, "");
+	}
+};
+
+struct fixture {
+	device a{"a", "01:02:03:04:05:06"};
+	device b{"b", "01:02:03:04:05:07"};
+	SesameGroup group;
+	TextSensor state;
+	Sensor completion;
+
+	fixture() {
+		a.component.set_connect_slots(2);
+		group.add_lock(&a.lock);
+		group.add_lock(&b.lock);
+		group.set_state_sensor(&state);
+		group.set_completion_time_sensor(&completion);
+		host::setup({&a.component, &b.component, &group});
+		run(100);
+		for (auto* d : {&a, &b}) {
+			d->client.fake_connected();
+		}
+		run(100);
+		for (auto* d : {&a, &b}) {
+			d->client.fake_authenticated();
+		}
+		run(100);
+	}
+	void run(uint32_t duration) { host::run({&a.component, &b.component, &group}, duration); }
+	void status(device& d, const SesameClient::Status& status) {
+		d.client.fake_status(status);
+		run(16);
+	}
+};
+
+}  // namespace
+
+int
+main() {
+	host::test("group state follows members", [] {
+		fixture f;
+		f.status(f.a, UNLOCKED);
+		f.status(f.b, LOCKED);
+		CHECK(f.state.published.back() == "partial");
+		f.status(f.a, LOCKED);
+		CHECK(f.state.published.back() == "locked");
+	});
+	host::test("completion time measured until every member reports", [] {
+		fixture f;
+		f.status(f.a, UNLOCKED);
+		f.status(f.b, UNLOCKED);
+		f.group.lock_all();
+		CHECK(f.a.client.commands == std::vector<std::string>{"lock"});
+		CHECK(f.b.client.commands == std::vector<std::string>{"lock"});
+		CHECK(f.state.published.back() == "moving");
+		f.run(500);
+		f.status(f.a, LOCKING);
+		f.status(f.a, LOCKED);
+		CHECK(f.completion.published.empty());
+		f.run(300);
+		f.status(f.b, LOCKED);
+		CHECK(f.completion.published.size() == 1);
+		CHECK(f.completion.published.back() >= 800);
+		CHECK(f.state.published.back() == "locked");
+	});
+	host::test("member already at the target still reports after the command", [] {
+		fixture f;
+		f.status(f.a, LOCKED);
+		f.status(f.b, UNLOCKED);
+		f.group.lock_all();
+		f.run(100);
+		f.status(f.b, LOCKED);
+		// a shows locking until its moving state times out
+		CHECK(f.completion.published.empty());
+		f.run(3'000);
+		CHECK(f.completion.published.size() == 1);
+		CHECK(f.completion.published.back() >= 3'000);
+	});
+	host::test("queued command counts only after it is sent", [] {
+		fixture f;
+		f.status(f.a, LOCKED);
+		f.status(f.b, LOCKED);
+		f.b.client.fake_disconnected();
+		f.b.client.connect_error = 13;
+		f.run(1'100);
+		f.group.lock_all();
+		CHECK(f.b.client.commands.empty());
+		f.status(f.a, LOCKED);
+		f.run(3'100);
+		CHECK(f.completion.published.empty());
+		f.b.client.connect_error = 0;
+		for (int i = 0; i < 100 && f.b.client.state != SesameClient::state_t::connecting; i++) {
+			f.run(100);
+		}
+		f.b.client.fake_connected();
+		f.run(100);
+		f.b.client.fake_authenticated();
+		f.run(100);
+		CHECK(f.b.client.commands == std::vector<std::string>{"lock"});
+		CHECK(f.completion.published.empty());
+		f.status(f.b, LOCKED);
+		CHECK(f.completion.published.size() == 1);
+	});
+	host::test("member not reaching the target times out", [] {
+		fixture f;
+		f.group.set_operation_timeout(10'000);
+		f.status(f.a, UNLOCKED);
+		f.status(f.b, UNLOCKED);
+		f.b.client.fake_disconnected();
+		f.group.lock_all();
+		f.status(f.a, LOCKED);
+		f.run(9'000);
+		CHECK(f.completion.published.empty());
+		f.run(1'100);
+		CHECK(f.completion.published.size() == 1 && std::isnan(f.completion.published.back()));
+	});
+	return host::finish();
+}
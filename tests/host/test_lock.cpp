@@ -0,0 +1,363 @@
+#include <esphome/core/helpers.h>
+#include <sesame/lock_feature.h>
+#include <sesame/sesame_component.h>
+#include <vector>
+#include "host.h"
+
+using esphome::lock::LockState;
+using esphome::sensor::Sensor;
+using esphome::sesame_lock::SesameComponent;
+using esphome::sesame_lock::SesameLock;
+using esphome::text_sensor::TextSensor;
+using libsesame3bt::Sesame;
+using libsesame3bt::SesameClient;
+using history_type_t = Sesame::history_type_t;
+using motor_status_t = Sesame::motor_status_t;
+
+namespace {
+
+const SesameClient::Status LOCKED{true, false, 0, 0};
+const SesameClient::Status UNLOCKED{false, true, 100, 100};
+
+struct device {
+	SesameComponent component{"s1"};
+	SesameClient& client{*SesameClient::instances().back()};
+	SesameLock lock{&component, Sesame::model_t::sesame_5, "esphome"};
+	std::vector<LockState> states;
+
+	device() {
+		lock.add_on_state_callback([this](LockState state) { states.push_back(state); });
+	}
+	// Call after configuring sensors and options, in the order of the generated code
+	void start() {
+		component.set_feature(&lock);
+		lock.init();
+		component.init(Sesame::model_t::sesame_5, "00", "00", "01:02:03:04:05:06", "");
+		host::setup({&component});
+		host::run({&component}, 100);
+		client.fake_connected();
+		host::run({&component}, 100);
+		client.fake_authenticated();
+		host::run({&component}, 100);
+		states.clear();
+	}
+	void run(uint32_t duration) { host::run({&component}, duration); }
+	void status(const SesameClient::Status& status) {
+		client.fake_status(status);
+		run(16);
+	}
+	void history(int32_t record_id,
+	             history_type_t type,
+	             const char* tag = "",
+	             float scaled_voltage = 0,
+	             const std::string& extra = {}) {
+		SesameClient::History h;
+		h.record_id = record_id;
+		h.type = type;
+		h.tag_len = std::strlen(tag);
+		h.scaled_voltage = scaled_voltage;
+		h.extra = extra;
+		std::strcpy(h.tag, tag);
+		client.fake_history(h);
+		run(16);
+	}
+	void history_end() {
+		SesameClient::History h;
+		h.result = Sesame::result_code_t::not_found;
+		client.fake_history(h);
+		run(16);
+	}
+};
+
+void
+save_record_id(const char* id, int32_t record_id) {
+	esphome::global_preferences->make_preference<int32_t>(esphome::fnv1_hash(std::string{"sesame_record_id_"} + id), true)
+	    .save(&record_id);
+}
+
+}  // namespace
+
+int
+main() {
+	host::test("lock state without history", [] {
+		device dev;
+		dev.start();
+		dev.status(LOCKED);
+		CHECK(dev.states == std::vector{esphome::lock::LOCK_STATE_LOCKED});
+		CHECK(dev.client.history_requests == 0);
+	});
+	host::test("lock state published with the matching history", [] {
+		device dev;
+		TextSensor tag;
+		dev.lock.set_history_tag_sensor(&tag);
+		dev.start();
+		dev.status(UNLOCKED);
+		CHECK(dev.states.empty());
+		CHECK(dev.client.history_requests == 1);
+		dev.history(10, history_type_t::manual_unlocked, "door");
+		CHECK(dev.states == std::vector{esphome::lock::LOCK_STATE_UNLOCKED});
+		CHECK(tag.published == std::vector<std::string>{"door"});
+	});
+	host::test("lock state published on history timeout", [] {
+		device dev;
+		TextSensor tag;
+		dev.lock.set_history_tag_sensor(&tag);
+		dev.start();
+		dev.status(LOCKED);
+		dev.run(3'900);
+		CHECK(dev.states.empty());
+		dev.run(200);
+		CHECK(dev.states == std::vector{esphome::lock::LOCK_STATE_LOCKED});
+	});
+	host::test("history already received still matches the lock state", [] {
+		save_record_id("s1", 10);
+		device dev;
+		TextSensor tag, all_tag;
+		dev.lock.set_history_tag_sensor(&tag);
+		dev.lock.set_all_history_tag_sensor(&all_tag);
+		dev.start();
+		// Backlog drain at connect: record 10 is known, nothing published to all_history
+		dev.history(10, history_type_t::manual_locked, "key");
+		CHECK(all_tag.published.empty());
+		dev.status(LOCKED);
+		dev.history(10, history_type_t::manual_locked, "key");
+		CHECK(dev.states == std::vector{esphome::lock::LOCK_STATE_LOCKED});
+		CHECK(tag.published == std::vector<std::string>{"key"});
+		CHECK(all_tag.published.empty());
+	});
+	host::test("record id is not persisted without all_history sensors", [] {
+		save_record_id("s1", 100);
+		device dev;
+		TextSensor tag;
+		dev.lock.set_history_tag_sensor(&tag);
+		dev.start();
+		auto saves = esphome::ESPPreferenceObject::save_count;
+		for (int32_t id = 1; id <= 10; id++) {
+			dev.status(id % 2 ? UNLOCKED : LOCKED);
+			dev.history(id, id % 2 ? history_type_t::manual_unlocked : history_type_t::manual_locked, "key");
+		}
+		CHECK(dev.states.size() == 10);
+		CHECK(tag.published.size() == 10);
+		CHECK(esphome::ESPPreferenceObject::save_count == saves);
+	});
+	host::test("history records handled without heap allocation", [] {
+		device dev;
+		TextSensor tag, all_tag, extra, event;
+		Sensor voltage;
+		dev.lock.set_history_tag_sensor(&tag);
+		dev.lock.set_all_history_tag_sensor(&all_tag);
+		dev.lock.set_history_extra_sensor(&extra);
+		dev.lock.set_history_event_sensor(&event);
+		dev.lock.set_history_scaled_voltage_sensor(&voltage);
+		for (auto* sensor : {&tag, &all_tag, &extra, &event}) {
+			sensor->keep_published = false;
+		}
+		voltage.published.reserve(64);
+		dev.states.reserve(64);
+		dev.start();
+		// Built once, the test itself must not allocate per record
+		SesameClient::History h;
+		h.tag_len = 3;
+		std::strcpy(h.tag, "key");
+		h.extra.assign(24, '\x5a');
+		auto record = [&](int32_t id) {
+			dev.status(id % 2 ? UNLOCKED : LOCKED);
+			h.record_id = id;
+			h.type = id % 2 ? history_type_t::manual_unlocked : history_type_t::manual_locked;
+			h.scaled_voltage = 6.0f - id * 0.01f;
+			dev.client.fake_history(h);
+			dev.run(16);
+		};
+		// The first records save the record_id and settle the buffers
+		for (int32_t id = 1; id <= 10; id++) {
+			record(id);
+		}
+		auto allocations = host::allocations();
+		for (int32_t id = 11; id <= 40; id++) {
+			record(id);
+		}
+		CHECK(host::allocations() == allocations);
+		CHECK(dev.states.size() == 40);
+		CHECK(tag.state == "key");
+		CHECK(extra.state.size() == 48 && extra.state.find_first_not_of("5a") == std::string::npos);
+		CHECK(event.state.find("\"id\":40,") != std::string::npos);
+	});
+	host::test("oversized history extra truncated with a warning", [] {
+		device dev;
+		TextSensor extra;
+		dev.lock.set_history_extra_sensor(&extra);
+		dev.start();
+		auto warnings = host::log_count('W');
+		dev.status(LOCKED);
+		dev.history(1, history_type_t::manual_locked, "key", 0, std::string(esphome::sesame_lock::MAX_HISTORY_EXTRA_SIZE + 4, '\x01'));
+		CHECK(host::log_count('W') == warnings + 1);
+		CHECK(extra.state.size() == esphome::sesame_lock::MAX_HISTORY_EXTRA_SIZE * 2);
+		CHECK(dev.states == std::vector{esphome::lock::LOCK_STATE_LOCKED});
+	});
+	host::test("history battery filtered by the lock", [] {
+		device dev;
+		Sensor voltage;
+		dev.lock.set_history_scaled_voltage_sensor(&voltage);
+		dev.lock.set_publish_filter(5, 0.1, 0);
+		dev.start();
+		dev.status(LOCKED);
+		dev.history(1, history_type_t::manual_locked, "a", 5.80);
+		dev.status(UNLOCKED);
+		dev.history(2, history_type_t::manual_unlocked, "b", 5.75);
+		CHECK(voltage.published == std::vector<float>{5.80f});
+		CHECK(voltage.state == 5.80f);
+		dev.status(LOCKED);
+		dev.history(3, history_type_t::manual_locked, "c", 5.60);
+		CHECK((voltage.published == std::vector<float>{5.80f, 5.60f}));
+	});
+	host::test("history backlog drained at connect", [] {
+		save_record_id("s1", 10);
+		device dev;
+		TextSensor all_tag;
+		dev.lock.set_all_history_tag_sensor(&all_tag);
+		dev.start();
+		CHECK(dev.client.history_requests == 1);
+		// Oldest first, until SESAME has no more history
+		dev.history(11, history_type_t::manual_locked, "a");
+		dev.history(12, history_type_t::manual_unlocked, "b");
+		dev.history(13, history_type_t::manual_locked, "c");
+		CHECK(all_tag.published == (std::vector<std::string>{"a", "b", "c"}));
+		CHECK(dev.client.history_requests == 4);
+		dev.history_end();
+		// Caught up, the next status requests the history of itself only
+		dev.status(LOCKED);
+		CHECK(dev.client.history_requests == 5);
+	});
+	host::test("lost backlog response ends the drain", [] {
+		device dev;
+		TextSensor tag, all_tag;
+		dev.lock.set_history_tag_sensor(&tag);
+		dev.lock.set_all_history_tag_sensor(&all_tag);
+		dev.start();
+		CHECK(dev.client.history_requests == 1);
+		dev.history(11, history_type_t::manual_locked, "a");
+		CHECK(dev.client.history_requests == 2);
+		// The response to the second request never arrives
+		dev.run(4'100);
+		dev.status(UNLOCKED);
+		CHECK(dev.client.history_requests == 3);
+		dev.history(12, history_type_t::manual_unlocked, "b");
+		CHECK(dev.states == std::vector{esphome::lock::LOCK_STATE_UNLOCKED});
+		CHECK((all_tag.published == std::vector<std::string>{"a", "b"}));
+		auto calls = host::loop_calls(&dev.component);
+		dev.run(10'000);
+		CHECK(host::loop_calls(&dev.component) - calls <= 20);
+	});
+	host::test("record_id saved while the loop sleeps", [] {
+		device dev;
+		TextSensor all_tag;
+		dev.lock.set_all_history_tag_sensor(&all_tag);
+		dev.start();
+		dev.history_end();
+		dev.status(LOCKED);
+		dev.history(11, history_type_t::manual_locked, "a");
+		auto saves = esphome::ESPPreferenceObject::save_count;
+		auto calls = host::loop_calls(&dev.component);
+		dev.run(61'000);
+		CHECK(esphome::ESPPreferenceObject::save_count == saves + 1);
+		CHECK(host::loop_calls(&dev.component) - calls <= 80);
+	});
+	host::test("command sent and lock state follows", [] {
+		device dev;
+		dev.start();
+		dev.lock.lock();
+		CHECK(dev.client.commands == std::vector<std::string>{"lock"});
+		CHECK(dev.states == std::vector{esphome::lock::LOCK_STATE_LOCKING});
+		dev.status(SesameClient::Status{false, false, 50, 0, motor_status_t::locking});
+		dev.status(LOCKED);
+		CHECK(dev.states.back() == esphome::lock::LOCK_STATE_LOCKED);
+	});
+	host::test("command queued until connected", [] {
+		device dev;
+		dev.lock.set_command_queue_timeout(10'000);
+		dev.component.set_always_connect(false);
+		dev.component.set_feature(&dev.lock);
+		dev.lock.init();
+		dev.component.init(Sesame::model_t::sesame_5, "00", "00", "01:02:03:04:05:06", "");
+		host::setup({&dev.component});
+		dev.run(1'000);
+		CHECK(dev.client.connect_count == 0);
+		dev.lock.unlock();
+		dev.run(100);
+		CHECK(dev.client.connect_count == 0);
+		host::advertise("01:02:03:04:05:06");
+		dev.run(100);
+		CHECK(dev.client.connect_count == 1);
+		dev.client.fake_connected();
+		dev.run(100);
+		dev.client.fake_authenticated();
+		dev.run(100);
+		CHECK(dev.client.commands == std::vector<std::string>{"unlock"});
+	});
+	for (bool always_connect : {false, true}) {
+		host::test(always_connect ? "failed connect retried while a command is queued (always_connect)"
+		                          : "failed connect retried while a command is queued", [always_connect] {
+			device dev;
+			dev.lock.set_command_queue_timeout(10'000);
+			dev.component.set_always_connect(always_connect);
+			dev.component.set_connect_retry_interval(30'000, 60'000);
+			dev.component.set_feature(&dev.lock);
+			dev.lock.init();
+			dev.component.init(Sesame::model_t::sesame_5, "00", "00", "01:02:03:04:05:06", "");
+			host::setup({&dev.component});
+			dev.run(100);
+			host::advertise("01:02:03:04:05:06");
+			dev.run(100);
+			if (dev.client.state == SesameClient::state_t::connecting) {
+				// always_connect, backoff after this failure
+				dev.client.fake_connect_failed(13);
+				dev.run(100);
+			}
+			auto attempts = dev.client.connect_count;
+			dev.lock.unlock();
+			dev.run(100);
+			CHECK(dev.client.connect_count == attempts + 1);
+			dev.client.fake_connect_failed(13);
+			dev.run(100);
+			CHECK(dev.client.connect_count == attempts + 2);
+			dev.client.fake_connected();
+			dev.run(100);
+			dev.client.fake_authenticated();
+			dev.run(100);
+			CHECK(dev.client.commands == std::vector<std::string>{"unlock"});
+		});
+	}
+	host::test("loop sleeps after a command latency measurement", [] {
+		device dev;
+		Sensor latency;
+		dev.lock.set_command_latency_sensor(esphome::sesame_lock::latency_stat_t::last, &latency);
+		dev.start();
+		dev.status(UNLOCKED);
+		dev.lock.lock();
+		dev.run(200);
+		dev.status(SesameClient::Status{false, false, 50, 0, motor_status_t::locking});
+		dev.run(200);
+		dev.status(LOCKED);
+		CHECK(latency.published.size() == 1);
+		dev.run(4'000);
+		auto calls = host::loop_calls(&dev.component);
+		dev.run(10'000);
+		CHECK(host::loop_calls(&dev.component) - calls <= 20);
+	});
+	host::test("stalled motor is jammed", [] {
+		device dev;
+		Sensor stall_position;
+		dev.lock.set_stall_timeout(1'000);
+		dev.lock.set_stall_position_sensor(&stall_position);
+		dev.start();
+		dev.status(SesameClient::Status{false, false, 30, 0, motor_status_t::locking});
+		dev.run(600);
+		dev.status(SesameClient::Status{false, false, 20, 0, motor_status_t::locking});
+		dev.run(600);
+		CHECK(dev.states.empty());
+		dev.run(500);
+		CHECK(dev.states == std::vector{esphome::lock::LOCK_STATE_JAMMED});
+		CHECK(stall_position.published == std::vector<float>{20});
+	});
+	return host::finish();
+}
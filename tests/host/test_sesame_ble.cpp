@@ -0,0 +1,88 @@
+#include <Sesame.h>
+#include <sesame_ble/sesame_ble.h>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#include "host.h"
+
+using esphome::esp32_ble::ESPBTUUID;
+using esphome::esp32_ble_tracker::ESPBTDevice;
+using esphome::esp32_ble_tracker::ServiceData;
+using esphome::sesame_ble::SesameBleListener;
+using libsesame3bt::Sesame;
+
+namespace {
+
+ESPBTDevice
+sesame(uint64_t address) {
+	ESPBTDevice device;
+	device.address = address;
+	device.service_uuids.push_back(ESPBTUUID::from_raw(Sesame::SESAME3_SRV_UUID));
+	ServiceData data{ESPBTUUID::from_uint16(0x055a), std::vector<uint8_t>(18)};
+	data.data[0] = static_cast<uint8_t>(Sesame::model_t::sesame_5);
+	device.manufacturer_datas.push_back(data);
+	return device;
+}
+
+// Some other device advertising a 16-bit service and manufacturer data
+ESPBTDevice
+other(uint64_t address) {
+	ESPBTDevice device;
+	device.address = address;
+	device.service_uuids.push_back(ESPBTUUID::from_uint16(0x180f));
+	device.manufacturer_datas.push_back(ServiceData{ESPBTUUID::from_uint16(0x004c), std::vector<uint8_t>(20)});
+	return device;
+}
+
+}  // namespace
+
+int
+main() {
+	host::test("SESAME reported once per interval", [] {
+		SesameBleListener listener;
+		auto dev = sesame(0xc0'01'02'03'04'05);
+		CHECK(listener.parse_device(dev));
+		host::advance(9'000);
+		CHECK(!listener.parse_device(dev));
+		host::advance(1'000);
+		CHECK(listener.parse_device(dev));
+	});
+	host::test("other devices not reported", [] {
+		SesameBleListener listener;
+		CHECK(!listener.parse_device(other(0xc0'01'02'03'04'05)));
+		CHECK(!listener.parse_device(other(0xc0'01'02'03'04'05)));
+	});
+	host::test("advertisement flood", [] {
+		constexpr int SESAMES = 32;
+		constexpr int OTHERS = 2'048;
+		constexpr int ROUNDS = 200;
+		SesameBleListener listener;
+		std::vector<ESPBTDevice> devices;
+		for (int i = 0; i < OTHERS; i++) {
+			devices.push_back(other(0x40'00'00'00'00'00 + i * 0x1'01));
+			if (i % (OTHERS / SESAMES) == 0) {
+				devices.push_back(sesame(0xc0'00'00'00'00'00 + i * 0x1'01));
+			}
+		}
+		int reported = 0;
+		for (const auto& dev : devices) {
+			reported += listener.parse_device(dev);
+		}
+		CHECK(reported == SESAMES);
+		// Each SESAME is already reported in this interval, no advertisement is logged or allocates
+		reported = 0;
+		auto allocations = host::allocations();
+		auto start = std::chrono::steady_clock::now();
+		for (int round = 0; round < ROUNDS; round++) {
+			for (const auto& dev : devices) {
+				reported += listener.parse_device(dev);
+			}
+		}
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		CHECK(host::allocations() == allocations);
+		CHECK(reported == 0);
+		std::printf("%zu advertisements in %.3f s, %.0f ads/s\n", devices.size() * ROUNDS, elapsed.count(),
+		            devices.size() * ROUNDS / elapsed.count());
+	});
+	return host::finish();
+}